@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Runs a match_submissions checker over every unordered pair of a class.
+//
+// The pairs are sorted by the product of their token counts, largest first,
+// and worker threads claim them one at a time from a shared atomic cursor.
+// Expensive pairs start early and cheap ones fill in at the end, so no
+// thread is left with a long pair when the rest have finished.
+//
+// compare_all_pairs is the two-phase form: each submission is prepared once,
+// in parallel, and the pairs only compare the prepared indices.
+//
+// Submissions may be any indexable container of token sequences with size(),
+// begin() and end(): std::vector<std::vector<int>>, or the spans of a
+// corpus::corpus_t.
+namespace all_pairs {
+
+struct pair_result_t {
+    std::size_t first; // Index of the first submission, first < second.
+    std::size_t second;
+    std::array<int, 5> result;
+};
+
+// Number of worker threads used when none is given.
+inline unsigned default_threads(void) {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Pairs (i, j) with i < j, most expensive first. Ties keep row-major order.
+template <typename Submissions>
+std::vector<std::pair<std::size_t, std::size_t>> schedule(const Submissions& submissions) {
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    std::size_t n = submissions.size();
+    pairs.reserve(n < 2 ? 0 : n * (n - 1) / 2);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = i + 1; j < n; ++j) {
+            pairs.emplace_back(i, j);
+        }
+    }
+    auto cost = [&](const std::pair<std::size_t, std::size_t>& pair) {
+        return static_cast<std::uint64_t>(submissions[pair.first].size())
+               * submissions[pair.second].size();
+    };
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [&](const auto& a, const auto& b) { return cost(a) > cost(b); });
+    return pairs;
+}
+
+namespace detail {
+
+// Calls task(k) for k = 0 .. count - 1 on the given number of threads, the
+// calling thread included, in increasing order of k. If a task throws, the
+// remaining ones are abandoned and the first exception is rethrown once
+// every thread has stopped.
+template <typename Task>
+void parallel_for(std::size_t count, unsigned threads, Task task) {
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        while (!failed.load(std::memory_order_relaxed)) {
+            std::size_t k = next.fetch_add(1, std::memory_order_relaxed);
+            if (k >= count) {
+                return;
+            }
+            try {
+                task(k);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_relaxed);
+                return;
+            }
+        }
+    };
+
+    threads = std::max(1u, std::min<unsigned>(threads, std::max<std::size_t>(count, 1)));
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace detail
+
+// Calls match(first, second) for every pair and sink(pair_result_t) with each
+// result as soon as it is known. Results arrive in completion order; calls to
+// sink are serialized, so it needs no locking of its own. match gets copies of
+// the token vectors, as match_submissions takes them by non-const reference.
+//
+// If match or sink throws, the remaining pairs are abandoned and the first
+// exception is rethrown once every worker has stopped.
+template <typename Submissions, typename Match, typename Sink>
+void match_all_pairs(const Submissions& submissions, Match match,
+                     Sink sink, unsigned threads = default_threads()) {
+    const std::vector<std::pair<std::size_t, std::size_t>> pairs = schedule(submissions);
+    std::mutex sink_mutex;
+    detail::parallel_for(pairs.size(), threads, [&](std::size_t k) {
+        auto [i, j] = pairs[k];
+        std::vector<int> first(submissions[i].begin(), submissions[i].end());
+        std::vector<int> second(submissions[j].begin(), submissions[j].end());
+        pair_result_t done{i, j, match(first, second)};
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        sink(done);
+    });
+}
+
+// Like match_all_pairs for a checker split into prepare(tokens), which builds
+// a per-submission index, and compare(index, index). Every submission is
+// prepared exactly once, so preparation costs O(N) instead of O(N^2) for N
+// submissions; all indices are kept until the last pair is done.
+template <typename Submissions, typename Prepare, typename Compare, typename Sink>
+void compare_all_pairs(const Submissions& submissions, Prepare prepare,
+                       Compare compare, Sink sink, unsigned threads = default_threads()) {
+    using index_t = decltype(prepare(submissions.front()));
+    std::vector<index_t> indices(submissions.size());
+    // Largest submissions first, for the same reason as the pairs.
+    std::vector<std::size_t> order(submissions.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return submissions[a].size() > submissions[b].size();
+    });
+    detail::parallel_for(order.size(), threads, [&](std::size_t k) {
+        indices[order[k]] = prepare(submissions[order[k]]);
+    });
+
+    const std::vector<std::pair<std::size_t, std::size_t>> pairs = schedule(submissions);
+    std::mutex sink_mutex;
+    detail::parallel_for(pairs.size(), threads, [&](std::size_t k) {
+        auto [i, j] = pairs[k];
+        pair_result_t done{i, j, compare(indices[i], indices[j])};
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        sink(done);
+    });
+}
+
+// Sink that writes one line per pair: "first second r0 r1 r2 r3 r4".
+class line_writer_t {
+public:
+    explicit line_writer_t(std::ostream& out) : out_(&out) {}
+
+    void operator()(const pair_result_t& pair) const {
+        *out_ << pair.first << ' ' << pair.second;
+        for (int value : pair.result) {
+            *out_ << ' ' << value;
+        }
+        *out_ << '\n';
+    }
+
+private:
+    std::ostream* out_;
+};
+
+} // namespace all_pairs
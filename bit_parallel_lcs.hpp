@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Bit-parallel longest common subsequence (Allison-Dix, in Hyyro's form).
+//
+// Row i of the LCS table dp over a (rows) and b (columns) is encoded as a bit
+// vector V_i over the columns: bit j - 1 is 0 exactly when
+// dp[i][j] = dp[i][j - 1] + 1, so dp[i][j] is the number of zero bits among
+// the first j bits. With M the bit set of the columns holding a[i - 1],
+//
+//     U = V & M,  V' = (V + U) | (V & ~M)
+//
+// advances one row, 64 columns per word operation. The rows (one bit per cell
+// instead of one int) also allow the exact traceback of the textbook table,
+// so callers get the same index pairs as before. The traceback keeps only
+// every stride-th row and recomputes the others a block at a time.
+namespace bit_parallel_lcs {
+
+using word_t = std::uint64_t;
+constexpr int WORD_BITS = 64;
+
+// Match masks of the column sequence: for each distinct token, the set of
+// columns holding it.
+class match_masks_t {
+public:
+    explicit match_masks_t(std::span<const int> columns)
+        : words_((static_cast<int>(columns.size()) + WORD_BITS - 1) / WORD_BITS),
+          tokens_(columns.begin(), columns.end()) {
+        std::sort(tokens_.begin(), tokens_.end());
+        tokens_.erase(std::unique(tokens_.begin(), tokens_.end()), tokens_.end());
+        masks_.assign(tokens_.size() * words_, 0);
+        for (int j = 0; j < static_cast<int>(columns.size()); ++j) {
+            word_t* mask = masks_.data() + index(columns[j]) * words_;
+            mask[j / WORD_BITS] |= word_t(1) << (j % WORD_BITS);
+        }
+    }
+
+    int words(void) const { return words_; }
+
+    // Mask of a token, or nullptr if the token does not occur in the columns.
+    const word_t* find(int token) const {
+        auto it = std::lower_bound(tokens_.begin(), tokens_.end(), token);
+        if (it == tokens_.end() || *it != token) {
+            return nullptr;
+        }
+        return masks_.data() + (it - tokens_.begin()) * words_;
+    }
+
+private:
+    std::size_t index(int token) const {
+        return std::lower_bound(tokens_.begin(), tokens_.end(), token) - tokens_.begin();
+    }
+
+    int words_;
+    std::vector<int> tokens_; // Distinct column tokens, sorted.
+    std::vector<word_t> masks_; // words_ words per token.
+};
+
+// Advances the row vector by one row whose token has the given match mask.
+inline void advance_row(word_t* row, const word_t* mask, int words) {
+    word_t carry = 0;
+    for (int w = 0; w < words; ++w) {
+        word_t v = row[w];
+        word_t m = mask[w];
+        word_t sum = v + (v & m);
+        word_t carry_out = sum < v;
+        sum += carry;
+        carry_out |= sum < carry;
+        carry = carry_out;
+        row[w] = sum | (v & ~m);
+    }
+}
+
+// Number of zero bits among the first count bits of a row, i.e. dp[i][count].
+inline int prefix_zeros(const word_t* row, int count) {
+    int ones = 0;
+    int full = count / WORD_BITS;
+    for (int w = 0; w < full; ++w) {
+        ones += std::popcount(row[w]);
+    }
+    if (count % WORD_BITS != 0) {
+        ones += std::popcount(row[full] & ((word_t(1) << (count % WORD_BITS)) - 1));
+    }
+    return count - ones;
+}
+
+// dp[i][j] - dp[i][j - 1] for the row holding dp[i][*].
+inline int column_step(const word_t* row, int j) {
+    return 1 - static_cast<int>((row[(j - 1) / WORD_BITS] >> ((j - 1) % WORD_BITS)) & 1);
+}
+
+// Length of the longest common subsequence of a and b.
+inline int length(std::span<const int> a, std::span<const int> b) {
+    match_masks_t masks(b);
+    std::vector<word_t> row(masks.words(), ~word_t(0));
+    for (int token : a) {
+        if (const word_t* mask = masks.find(token)) {
+            advance_row(row.data(), mask, masks.words());
+        }
+    }
+    return prefix_zeros(row.data(), static_cast<int>(b.size()));
+}
+
+// Index pairs (position in a, position in b) of a longest common subsequence,
+// in increasing order. The pairs are those found by filling the full table
+// and walking back from dp[m][n], taking the diagonal on equal tokens, going
+// up when dp[i - 1][j] > dp[i][j - 1] and left otherwise.
+//
+// Rows 0, stride, 2 * stride, ... are kept as checkpoints with stride about
+// sqrt(m). The walk only moves up, so each block of rows between two
+// checkpoints is recomputed once when the walk enters it: O(sqrt(m) * n)
+// bits of memory for one extra pass over the rows.
+inline std::vector<std::pair<int, int>> alignment(std::span<const int> a,
+                                                    std::span<const int> b) {
+    int m = static_cast<int>(a.size());
+    int n = static_cast<int>(b.size());
+    if (m == 0 || n == 0) {
+        return {};
+    }
+    match_masks_t masks(b);
+    int words = masks.words();
+    int stride = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(m))));
+
+    // Row i * stride at checkpoints[i * words]. Row 0 is all ones (dp[0][*] = 0).
+    std::vector<word_t> checkpoints(static_cast<std::size_t>(m / stride + 1) * words, ~word_t(0));
+    std::vector<word_t> current_row(words, ~word_t(0));
+    for (int i = 1; i <= m; ++i) {
+        if (const word_t* mask = masks.find(a[i - 1])) {
+            advance_row(current_row.data(), mask, words);
+        }
+        if (i % stride == 0) {
+            std::copy(current_row.begin(), current_row.end(),
+                      checkpoints.begin() + static_cast<std::size_t>(i / stride) * words);
+        }
+    }
+
+    // Rows block_first .. block_first + stride (at most m), rebuilt from the
+    // checkpoint when the walk needs rows i - 1 and i from below it.
+    std::vector<word_t> block(static_cast<std::size_t>(stride + 1) * words);
+    int block_first = -1;
+    auto load = [&](int i) {
+        if (block_first >= 0 && i - 1 >= block_first) {
+            return;
+        }
+        block_first = (i - 1) / stride * stride;
+        const word_t* checkpoint = checkpoints.data() + static_cast<std::size_t>(block_first / stride) * words;
+        std::copy(checkpoint, checkpoint + words, block.begin());
+        int last = std::min(block_first + stride, m);
+        for (int r = block_first + 1; r <= last; ++r) {
+            word_t* row = block.data() + static_cast<std::size_t>(r - block_first) * words;
+            std::copy(row - words, row, row);
+            if (const word_t* mask = masks.find(a[r - 1])) {
+                advance_row(row, mask, words);
+            }
+        }
+    };
+    auto row = [&](int i) { return block.data() + static_cast<std::size_t>(i - block_first) * words; };
+
+    std::vector<std::pair<int, int>> pairs;
+    int i = m, j = n;
+    // current holds dp[i][j] and up holds dp[i - 1][j] when up_known; both follow the walk.
+    load(i);
+    int current = prefix_zeros(row(m), n);
+    int up = 0;
+    bool up_known = false;
+    while (i > 0 && j > 0) {
+        load(i);
+        if (!up_known) {
+            up = prefix_zeros(row(i - 1), j);
+            up_known = true;
+        }
+        if (a[i - 1] == b[j - 1]) {
+            pairs.push_back({i - 1, j - 1});
+            current = up - column_step(row(i - 1), j);
+            --i;
+            --j;
+            up_known = false;
+        } else if (up > current - column_step(row(i), j)) {
+            current = up;
+            --i;
+            up_known = false;
+        } else {
+            current -= column_step(row(i), j);
+            up -= column_step(row(i - 1), j);
+            --j;
+        }
+    }
+    std::reverse(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+} // namespace bit_parallel_lcs
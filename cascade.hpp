@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Cheap filters run before a checker's full comparison of a pair.
+//
+// Stage 0 compares token histograms. The number of tokens the submissions
+// have in common, counted with multiplicity, bounds every LCS, alignment or
+// run of matching positions between them. Stage 1 compares the sets of
+// hashes of WINDOW-token windows: if none is shared, no WINDOW tokens in a
+// row occur in both. Stage 2 is the checker itself.
+//
+// A checker opts in with a settle function, which gets these facts and
+// returns the checker's exact result when the facts determine it. Most
+// unrelated pairs are settled that way, which is what matters in all-pairs
+// runs. Checkers whose results depend on more than the facts have no settle
+// function and always run in full.
+namespace cascade {
+
+// Length of the windows compared by stage 1.
+constexpr int WINDOW = 10;
+
+// What stages 0 and 1 know about a pair. Each is an upper bound: settle
+// functions may only rely on them being small.
+struct facts_t {
+    int size1;
+    int size2;
+    int common_tokens; // Size of the multiset intersection of the tokens.
+    bool shares_window; // False proves that no WINDOW-token window occurs in both.
+};
+
+// Returns the checker's result for a pair with these facts, or nothing if
+// the facts do not determine it.
+using settle_function_t = std::optional<std::array<int, 5>> (*)(const facts_t&);
+
+// Per-submission data of stages 0 and 1, built once per submission.
+class profile_t {
+public:
+    profile_t(void) = default;
+
+    explicit profile_t(std::span<const int> tokens)
+        : size_(static_cast<int>(tokens.size())), sorted_(tokens.begin(), tokens.end()) {
+        std::sort(sorted_.begin(), sorted_.end());
+        // Polynomial hashes modulo 2^64; a collision can only make a pair look related.
+        constexpr std::uint64_t base = 0x100000001B3ull;
+        std::uint64_t top = 1; // base^(WINDOW - 1)
+        for (int k = 1; k < WINDOW; ++k) {
+            top *= base;
+        }
+        std::uint64_t hash = 0;
+        for (int i = 0; i < size_; ++i) {
+            if (i >= WINDOW) {
+                hash -= static_cast<std::uint32_t>(tokens[i - WINDOW]) * top;
+            }
+            hash = hash * base + static_cast<std::uint32_t>(tokens[i]);
+            if (i + 1 >= WINDOW) {
+                windows_.push_back(hash);
+            }
+        }
+        std::sort(windows_.begin(), windows_.end());
+        windows_.erase(std::unique(windows_.begin(), windows_.end()), windows_.end());
+    }
+
+    int size(void) const { return size_; }
+
+    // Stage 0: tokens in common, counted with multiplicity.
+    friend int common_tokens(const profile_t& first, const profile_t& second) {
+        int common = 0;
+        auto a = first.sorted_.begin(), b = second.sorted_.begin();
+        while (a != first.sorted_.end() && b != second.sorted_.end()) {
+            if (*a < *b) {
+                ++a;
+            } else if (*b < *a) {
+                ++b;
+            } else {
+                ++common;
+                ++a;
+                ++b;
+            }
+        }
+        return common;
+    }
+
+    // Stage 1: whether some window hash occurs in both.
+    friend bool shares_window(const profile_t& first, const profile_t& second) {
+        auto a = first.windows_.begin(), b = second.windows_.begin();
+        while (a != first.windows_.end() && b != second.windows_.end()) {
+            if (*a < *b) {
+                ++a;
+            } else if (*b < *a) {
+                ++b;
+            } else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    int size_ = 0;
+    std::vector<int> sorted_; // The tokens, sorted.
+    std::vector<std::uint64_t> windows_; // Distinct window hashes, sorted.
+};
+
+// Stage at which a pair was decided.
+enum class stage_t { histogram, windows, full };
+
+struct outcome_t {
+    std::array<int, 5> result;
+    stage_t stage;
+};
+
+// Runs stages 0 and 1 on a pair: the result if settle (which may be null)
+// can decide it from their facts, and the stage that did.
+inline std::optional<outcome_t> try_settle(const profile_t& first, const profile_t& second,
+                                           settle_function_t settle) {
+    if (settle == nullptr) {
+        return std::nullopt;
+    }
+    facts_t facts{first.size(), second.size(), common_tokens(first, second), false};
+    // Fewer common tokens than a window already rules out a shared window.
+    stage_t stage = stage_t::histogram;
+    if (facts.common_tokens >= WINDOW) {
+        facts.shares_window = shares_window(first, second);
+        stage = stage_t::windows;
+    }
+    if (std::optional<std::array<int, 5>> result = settle(facts)) {
+        return outcome_t{*result, stage};
+    }
+    return std::nullopt;
+}
+
+// try_settle for a single pair, profiling both submissions on the spot.
+inline std::optional<std::array<int, 5>> try_settle(std::span<const int> first, std::span<const int> second,
+                                                    settle_function_t settle) {
+    if (settle == nullptr) {
+        return std::nullopt;
+    }
+    if (std::optional<outcome_t> outcome = try_settle(profile_t(first), profile_t(second), settle)) {
+        return outcome->result;
+    }
+    return std::nullopt;
+}
+
+// All stages: full() is the checker's own comparison, called only if the
+// pair is not settled before.
+template <typename Full>
+outcome_t run(const profile_t& first, const profile_t& second, settle_function_t settle, Full full) {
+    if (std::optional<outcome_t> outcome = try_settle(first, second, settle)) {
+        return *outcome;
+    }
+    return {full(), stage_t::full};
+}
+
+// A submission's profile with a checker's own prepared index, for
+// all_pairs::compare_all_pairs.
+template <typename Index>
+struct prepared_t {
+    profile_t profile;
+    Index index;
+};
+
+} // namespace cascade
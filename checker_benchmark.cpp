@@ -0,0 +1,569 @@
+// Comparative benchmark of the registered checkers.
+//
+// Build: g++ -std=c++20 -O2 -pthread -o checker_benchmark checker_benchmark.cpp
+//
+// Every checker runs on the same generated pair corpus for each size. Each
+// run happens in a forked child, so a checker that crashes, runs out of
+// memory or hits the timeout does not take the benchmark down, and the peak
+// resident set of the child is the peak memory of that run. Allocations are
+// the calls to operator new during match_submissions. Agreement is the
+// share of pairs on which result[i] equals that of the reference checker.
+//
+// Options:
+//   --checkers=zero,one,...   checkers to run (default: all)
+//   --sizes=100,1000,...      token counts per submission (default: 100..20000)
+//   --pairs=N                 pairs per size (default: 6)
+//   --reference=NAME          checker the others are compared with (default: sample)
+//   --timeout=SECONDS         per run (default: 60)
+//   --memory-mb=MB            address space limit per run, 0 for none (default: 4096)
+//
+// With --all-pairs=N the benchmark instead times match_all_pairs (mode
+// "match"), compare_all_pairs on the checker's prepare/compare (mode
+// "prepared") and the same behind the checker's cascade filters (mode
+// "cascade", which also reports the share of pairs the filters settled) over
+// N submissions, with sizes cycling through --sizes, for each thread count in
+// --threads=1,2,... (default: 1 and every power of two up to the core
+// count), and checks that every run yields the same results. Mode "cached"
+// adds a result cache in front of the cascade, kept across thread counts, so
+// the first run fills it and the rest are answered from it; its "settled"
+// column counts cache hits as well. Results are cached under the checker's
+// name and revision (result_cache_id), so a saved cache is not reused across
+// a revision bump. --cache=PATH loads the cache from PATH first and saves it
+// there afterwards. --corpus=PATH reads the submissions
+// from a corpus file, writing the generated ones there if it does not exist;
+// mode "match" then runs on views of the mapped file. Each worker gives
+// checker_five its share of the cores (checker_five::set_thread_budget), so
+// the strips and stages of a large pair do not multiply the pool's threads.
+//
+// With --latency=N the benchmark times each checker on one N-token pair of
+// every kind, for each thread budget in --threads, and checks that the
+// results do not depend on the budget: the latency of one comparison against
+// the cores it may use. Only checker_five runs threads of its own.
+#include "checker_registry.hpp"
+#include "all_pairs.hpp"
+#include "corpus.hpp"
+#include "result_cache.hpp"
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <new>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+} // namespace
+
+// Replaced so that every heap allocation of the process is counted; the array
+// and nothrow forms call this one. The deletes stay out of line, or GCC sees
+// free() inlined on memory from operator new and warns of a mismatch.
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size == 0 ? 1 : size)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+[[gnu::noinline]] void operator delete(void* block, std::size_t) noexcept {
+    std::free(block);
+}
+
+namespace {
+
+struct options_t {
+    std::vector<std::string> checkers;
+    std::vector<int> sizes = {100, 500, 1000, 2000, 5000, 10000, 20000};
+    int pairs = 6;
+    std::string reference = "sample";
+    int timeout = 60;
+    long memory_mb = 4096;
+    int all_pairs = 0; // Submissions in all-pairs mode, 0 for the per-pair table.
+    int latency = 0; // Tokens per submission in latency mode, 0 for the per-pair table.
+    std::vector<unsigned> threads;
+    std::string cache; // File the all-pairs result cache persists to, empty for none.
+    std::string corpus; // Corpus file of the all-pairs submissions, empty to generate them.
+};
+
+enum class status_t { ok, timeout, oom, crash };
+
+struct run_t {
+    status_t status;
+    std::array<int, 5> result;
+    double ms; // Time spent in match_submissions.
+    long peak_kb; // Peak resident set of the child.
+    std::size_t allocations; // Calls to operator new in match_submissions.
+};
+
+// What the child sends back through its pipe.
+struct child_report_t {
+    std::array<int, 5> result;
+    double ms;
+    std::size_t allocations;
+};
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> parts;
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t comma = list.find(',', start);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        if (comma > start) {
+            parts.push_back(list.substr(start, comma - start));
+        }
+        start = comma + 1;
+    }
+    return parts;
+}
+
+options_t parse_options(int argc, char** argv) {
+    options_t options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--checkers") {
+            options.checkers = split(value);
+        } else if (key == "--sizes") {
+            options.sizes.clear();
+            for (const std::string& size : split(value)) {
+                options.sizes.push_back(std::atoi(size.c_str()));
+            }
+        } else if (key == "--pairs") {
+            options.pairs = std::atoi(value.c_str());
+        } else if (key == "--reference") {
+            options.reference = value;
+        } else if (key == "--timeout") {
+            options.timeout = std::atoi(value.c_str());
+        } else if (key == "--memory-mb") {
+            options.memory_mb = std::atol(value.c_str());
+        } else if (key == "--all-pairs") {
+            options.all_pairs = std::atoi(value.c_str());
+        } else if (key == "--latency") {
+            options.latency = std::atoi(value.c_str());
+        } else if (key == "--corpus") {
+            options.corpus = value;
+        } else if (key == "--cache") {
+            options.cache = value;
+        } else if (key == "--threads") {
+            for (const std::string& count : split(value)) {
+                options.threads.push_back(static_cast<unsigned>(std::atoi(count.c_str())));
+            }
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            std::exit(2);
+        }
+    }
+    if (options.checkers.empty()) {
+        for (const checker_entry_t& entry : checker_registry()) {
+            options.checkers.emplace_back(entry.name);
+        }
+    }
+    if (options.threads.empty()) {
+        for (unsigned count = 1; count <= all_pairs::default_threads(); count *= 2) {
+            options.threads.push_back(count);
+        }
+        if (options.threads.back() != all_pairs::default_threads()) {
+            options.threads.push_back(all_pairs::default_threads());
+        }
+    }
+    return options;
+}
+
+// Draws tokens with a skewed distribution, as real token streams have a few
+// very common tokens (identifiers, punctuation) and a long tail.
+std::vector<int> random_tokens(std::mt19937& rng, int size) {
+    std::geometric_distribution<int> token(0.08);
+    std::vector<int> tokens(size);
+    for (int& t : tokens) {
+        t = std::min(token(rng), 199);
+    }
+    return tokens;
+}
+
+// Builds the pairs of one size. The kinds cycle through unrelated
+// submissions, a lightly edited copy, a copy with reordered blocks, and a
+// submission that borrows a single block.
+std::vector<std::pair<std::vector<int>, std::vector<int>>> make_pairs(int size, int count) {
+    std::mt19937 rng(static_cast<unsigned>(size) * 7919u + 17u);
+    std::vector<std::pair<std::vector<int>, std::vector<int>>> pairs;
+    for (int p = 0; p < count; ++p) {
+        std::vector<int> first = random_tokens(rng, size);
+        std::vector<int> second;
+        switch (p % 4) {
+        case 0:
+            second = random_tokens(rng, size);
+            break;
+        case 1: {
+            // Substitute, insert and drop about 5% of the tokens each.
+            std::uniform_int_distribution<int> percent(0, 99);
+            for (int t : first) {
+                int roll = percent(rng);
+                if (roll < 5) {
+                    second.push_back(random_tokens(rng, 1)[0]);
+                } else if (roll < 10) {
+                    second.push_back(t);
+                    second.push_back(random_tokens(rng, 1)[0]);
+                } else if (roll >= 15) {
+                    second.push_back(t);
+                }
+            }
+            break;
+        }
+        case 2: {
+            // Cut into blocks of 20..80 tokens and shuffle them.
+            std::uniform_int_distribution<int> block(20, 80);
+            std::vector<std::vector<int>> blocks;
+            for (std::size_t i = 0; i < first.size();) {
+                std::size_t end = std::min(first.size(), i + block(rng));
+                blocks.emplace_back(first.begin() + i, first.begin() + end);
+                i = end;
+            }
+            std::shuffle(blocks.begin(), blocks.end(), rng);
+            for (const std::vector<int>& b : blocks) {
+                second.insert(second.end(), b.begin(), b.end());
+            }
+            break;
+        }
+        default: {
+            // Borrow a quarter of the first submission into fresh code.
+            second = random_tokens(rng, size);
+            int length = size / 4;
+            std::uniform_int_distribution<int> start(0, size - length);
+            int from = start(rng), to = start(rng);
+            std::copy(first.begin() + from, first.begin() + from + length, second.begin() + to);
+            break;
+        }
+        }
+        pairs.emplace_back(std::move(first), std::move(second));
+    }
+    return pairs;
+}
+
+// Runs one checker on one pair in a forked child.
+run_t run_isolated(const checker_entry_t& checker, const std::vector<int>& first,
+                    const std::vector<int>& second, const options_t& options) {
+    run_t run{status_t::crash, {0, 0, 0, 0, 0}, 0.0, 0, 0};
+    int pipe_fds[2];
+    if (::pipe(pipe_fds) < 0) {
+        std::perror("pipe");
+        std::exit(1);
+    }
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        std::perror("fork");
+        std::exit(1);
+    }
+    if (pid == 0) {
+        ::close(pipe_fds[0]);
+        if (options.memory_mb > 0) {
+            rlimit limit;
+            limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(options.memory_mb) << 20;
+            ::setrlimit(RLIMIT_AS, &limit);
+        }
+        ::alarm(static_cast<unsigned>(options.timeout));
+        std::vector<int> a = first, b = second;
+        child_report_t report;
+        try {
+            std::size_t allocations_before = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            report.result = checker.match(a, b);
+            report.ms = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start).count();
+            report.allocations = allocations.load(std::memory_order_relaxed) - allocations_before;
+        } catch (const std::bad_alloc&) {
+            ::_exit(3);
+        } catch (const std::length_error&) {
+            ::_exit(3); // vector sizes past the limit fail this way.
+        }
+        ssize_t written = ::write(pipe_fds[1], &report, sizeof(report));
+        ::_exit(written == static_cast<ssize_t>(sizeof(report)) ? 0 : 1);
+    }
+
+    ::close(pipe_fds[1]);
+    child_report_t report;
+    ssize_t received = ::read(pipe_fds[0], &report, sizeof(report));
+    ::close(pipe_fds[0]);
+    int status = 0;
+    rusage usage{};
+    while (::wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    run.peak_kb = usage.ru_maxrss;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0
+            && received == static_cast<ssize_t>(sizeof(report))) {
+        run.status = status_t::ok;
+        run.result = report.result;
+        run.ms = report.ms;
+        run.allocations = report.allocations;
+    } else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+        run.status = status_t::timeout;
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) == 3) {
+        run.status = status_t::oom;
+    }
+    return run;
+}
+
+// Times match_all_pairs and compare_all_pairs for each checker and thread count.
+int run_all_pairs(const options_t& options, const std::vector<const checker_entry_t*>& checkers) {
+    std::vector<std::vector<int>> submissions;
+    std::optional<corpus::corpus_t> mapped;
+    if (!options.corpus.empty() && ::access(options.corpus.c_str(), F_OK) == 0) {
+        auto start = std::chrono::steady_clock::now();
+        mapped.emplace(options.corpus);
+        submissions.resize(mapped->size());
+        for (std::size_t i = 0; i < submissions.size(); ++i) {
+            mapped->copy(i, submissions[i]);
+        }
+        std::printf("read %zu submissions from %s in %.1f ms\n", submissions.size(), options.corpus.c_str(),
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    } else {
+        std::mt19937 rng(12345);
+        for (int i = 0; i < options.all_pairs; ++i) {
+            submissions.push_back(random_tokens(rng, options.sizes[i % options.sizes.size()]));
+        }
+        if (!options.corpus.empty()) {
+            corpus::write(options.corpus, submissions);
+            mapped.emplace(options.corpus);
+        }
+    }
+    std::size_t count = submissions.size();
+    result_cache::cache_t cache;
+    if (!options.cache.empty() && cache.load(options.cache)) {
+        std::printf("loaded %zu cached results from %s\n", cache.size(), options.cache.c_str());
+    }
+    std::printf("%-8s %-8s %7s %8s %10s %12s %8s %8s\n", "checker", "mode", "threads", "pairs",
+                "wall s", "pairs/s", "speedup", "settled");
+    for (const checker_entry_t* checker : checkers) {
+        std::vector<std::array<int, 5>> first_results;
+        double baseline = 0.0; // Wall time of the first run.
+        std::string cache_id = result_cache_id(*checker);
+        for (const char* mode : {"match", "prepared", "cascade", "cached"}) {
+            std::string_view name = mode;
+            for (unsigned threads : options.threads) {
+                // Each worker gets its share of the cores for checker_five's own threads.
+                checker_five::set_thread_budget(std::max(1u, all_pairs::default_threads() / threads));
+                std::vector<std::array<int, 5>> results(count * count);
+                std::size_t pairs = 0;
+                std::atomic<std::size_t> settled{0};
+                auto sink = [&](const all_pairs::pair_result_t& pair) {
+                    results[pair.first * count + pair.second] = pair.result;
+                    ++pairs;
+                };
+                auto start = std::chrono::steady_clock::now();
+                if (name == "cached") {
+                    struct cached_t {
+                        result_cache::fingerprint_t fingerprint;
+                        cascade::profile_t profile;
+                        prepared_index_t index;
+                    };
+                    all_pairs::compare_all_pairs(submissions,
+                        [&](const std::vector<int>& tokens) {
+                            return cached_t{result_cache::fingerprint(tokens), cascade::profile_t(tokens),
+                                            checker->prepare(tokens)};
+                        },
+                        [&](const cached_t& a, const cached_t& b) {
+                            if (std::optional<std::array<int, 5>> result =
+                                    cache.find(cache_id, a.fingerprint, b.fingerprint, checker->symmetric)) {
+                                settled.fetch_add(1, std::memory_order_relaxed);
+                                return *result;
+                            }
+                            cascade::outcome_t outcome = cascade::run(a.profile, b.profile, checker->settle,
+                                [&] { return checker->compare(a.index.get(), b.index.get()); });
+                            if (outcome.stage != cascade::stage_t::full) {
+                                // As cheap to settle again as to look up, so not worth keeping.
+                                settled.fetch_add(1, std::memory_order_relaxed);
+                            } else {
+                                cache.insert(cache_id, a.fingerprint, b.fingerprint, outcome.result);
+                            }
+                            return outcome.result;
+                        }, sink, threads);
+                } else if (name == "cascade") {
+                    using prepared_t = cascade::prepared_t<prepared_index_t>;
+                    all_pairs::compare_all_pairs(submissions,
+                        [&](const std::vector<int>& tokens) {
+                            return prepared_t{cascade::profile_t(tokens), checker->prepare(tokens)};
+                        },
+                        [&](const prepared_t& a, const prepared_t& b) {
+                            cascade::outcome_t outcome = cascade::run(a.profile, b.profile, checker->settle,
+                                [&] { return checker->compare(a.index.get(), b.index.get()); });
+                            if (outcome.stage != cascade::stage_t::full) {
+                                settled.fetch_add(1, std::memory_order_relaxed);
+                            }
+                            return outcome.result;
+                        }, sink, threads);
+                } else if (name == "prepared") {
+                    all_pairs::compare_all_pairs(submissions, checker->prepare,
+                        [&](const prepared_index_t& a, const prepared_index_t& b) {
+                            return checker->compare(a.get(), b.get());
+                        }, sink, threads);
+                } else {
+                    if (mapped && mapped->width() == corpus::width_t::int32) {
+                        all_pairs::match_all_pairs(mapped->views(), checker->match, sink, threads);
+                    } else {
+                        all_pairs::match_all_pairs(submissions, checker->match, sink, threads);
+                    }
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (first_results.empty()) {
+                    first_results = results;
+                    baseline = seconds;
+                } else if (results != first_results) {
+                    std::fprintf(stderr, "%.*s: results differ in %s mode with %u threads\n",
+                                 static_cast<int>(checker->name.size()), checker->name.data(),
+                                 mode, threads);
+                    return 1;
+                }
+                std::printf("%-8.*s %-8s %7u %8zu %10.2f %12.1f %8.2f %7.1f%%\n",
+                            static_cast<int>(checker->name.size()), checker->name.data(),
+                            mode, threads, pairs, seconds, pairs / seconds, baseline / seconds,
+                            pairs > 0 ? 100.0 * settled.load() / pairs : 0.0);
+                std::fflush(stdout);
+            }
+        }
+    }
+    checker_five::set_thread_budget(0);
+    if (!options.cache.empty() && !cache.save(options.cache)) {
+        std::fprintf(stderr, "cannot save the result cache to %s\n", options.cache.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// Times each checker on one pair of every kind for each thread budget, i.e. the latency of a single
+// comparison against the cores it may use.
+int run_latency(const options_t& options, const std::vector<const checker_entry_t*>& checkers) {
+    auto pairs = make_pairs(options.latency, 4);
+    std::printf("%-8s %6s %7s %10s %8s\n", "checker", "size", "threads", "ms/pair", "speedup");
+    for (const checker_entry_t* checker : checkers) {
+        std::vector<std::array<int, 5>> first_results;
+        double baseline = 0.0; // Time per pair with the first budget.
+        for (unsigned threads : options.threads) {
+            checker_five::set_thread_budget(threads);
+            std::vector<std::array<int, 5>> results;
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& [first, second] : pairs) {
+                std::vector<int> a = first, b = second;
+                results.push_back(checker->match(a, b));
+            }
+            double ms = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start).count() / pairs.size();
+            if (first_results.empty()) {
+                first_results = results;
+                baseline = ms;
+            } else if (results != first_results) {
+                std::fprintf(stderr, "%.*s: results differ with %u threads\n",
+                             static_cast<int>(checker->name.size()), checker->name.data(), threads);
+                return 1;
+            }
+            std::printf("%-8.*s %6d %7u %10.1f %8.2f\n", static_cast<int>(checker->name.size()),
+                        checker->name.data(), options.latency, threads, ms, baseline / ms);
+            std::fflush(stdout);
+        }
+    }
+    checker_five::set_thread_budget(0);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    options_t options = parse_options(argc, argv);
+    const checker_entry_t* reference = find_checker(options.reference);
+    if (reference == nullptr) {
+        std::fprintf(stderr, "unknown reference checker %s\n", options.reference.c_str());
+        return 2;
+    }
+    std::vector<const checker_entry_t*> checkers;
+    for (const std::string& name : options.checkers) {
+        const checker_entry_t* entry = find_checker(name);
+        if (entry == nullptr) {
+            std::fprintf(stderr, "unknown checker %s\n", name.c_str());
+            return 2;
+        }
+        checkers.push_back(entry);
+    }
+    if (options.all_pairs > 0) {
+        return run_all_pairs(options, checkers);
+    }
+    if (options.latency > 0) {
+        return run_latency(options, checkers);
+    }
+
+    std::printf("%-8s %6s %4s %4s %4s %4s %10s %10s %9s %10s   agreement with %s r[0..4] (%%)\n",
+                "checker", "size", "ok", "tout", "oom", "crsh", "mean ms", "max ms",
+                "peak MB", "allocs", options.reference.c_str());
+    for (int size : options.sizes) {
+        auto pairs = make_pairs(size, options.pairs);
+        std::vector<run_t> reference_runs;
+        for (const auto& [first, second] : pairs) {
+            reference_runs.push_back(run_isolated(*reference, first, second, options));
+        }
+
+        for (const checker_entry_t* checker : checkers) {
+            int counts[4] = {0, 0, 0, 0};
+            double total_ms = 0.0, max_ms = 0.0, total_allocations = 0.0;
+            long peak_kb = 0;
+            int compared = 0;
+            std::array<int, 5> agree = {0, 0, 0, 0, 0};
+            for (std::size_t p = 0; p < pairs.size(); ++p) {
+                run_t run = checker == reference
+                            ? reference_runs[p]
+                            : run_isolated(*checker, pairs[p].first, pairs[p].second, options);
+                ++counts[static_cast<int>(run.status)];
+                peak_kb = std::max(peak_kb, run.peak_kb);
+                if (run.status != status_t::ok) {
+                    continue;
+                }
+                total_ms += run.ms;
+                total_allocations += static_cast<double>(run.allocations);
+                max_ms = std::max(max_ms, run.ms);
+                if (reference_runs[p].status == status_t::ok) {
+                    ++compared;
+                    for (int i = 0; i < 5; ++i) {
+                        agree[i] += run.result[i] == reference_runs[p].result[i];
+                    }
+                }
+            }
+
+            std::printf("%-8.*s %6d %4d %4d %4d %4d", static_cast<int>(checker->name.size()),
+                        checker->name.data(), size, counts[0], counts[1], counts[2], counts[3]);
+            if (counts[0] > 0) {
+                std::printf(" %10.1f %10.1f", total_ms / counts[0], max_ms);
+            } else {
+                std::printf(" %10s %10s", "-", "-");
+            }
+            std::printf(" %9.1f", peak_kb / 1024.0);
+            if (counts[0] > 0) {
+                std::printf(" %10.0f  ", total_allocations / counts[0]);
+            } else {
+                std::printf(" %10s  ", "-");
+            }
+            for (int i = 0; i < 5; ++i) {
+                if (compared > 0) {
+                    std::printf(" %5.0f", 100.0 * agree[i] / compared);
+                } else {
+                    std::printf(" %5s", "-");
+                }
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
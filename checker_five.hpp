@@ -11,35 +11,23 @@
 #include <unordered_map>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
 
 // -----------------------------------------------------------------------------
+#include <atomic>
+#include <future>
+#include <thread>
+#include "cascade.hpp"
+#include "suffix_array.hpp"
 
 // You are free to add any STL includes above this comment, below the --line--.
 // DO NOT add "using namespace std;" or include any other files/libraries.
 // Also DO NOT add the include "bits/stdc++.h"
 
 // OPTIONAL: Add your helper functions and data structures here
-
-class TrieNode {
-public:
-    std::unordered_map<int, TrieNode*> children;
-    int start;
-    std::shared_ptr<int> end;
-    int suffixIndex;
-    TrieNode* suffixLink;
-    bool isLeaf; 
-    int children_count;
-
-    TrieNode(int start, std::shared_ptr<int> end) 
-        : start(start), end(end), suffixIndex(-1), suffixLink(nullptr), isLeaf(false) {}
-
-    TrieNode(int start, std::shared_ptr<int> end, bool isLeaf) 
-        : start(start), end(end), suffixIndex(-1), suffixLink(nullptr), isLeaf(isLeaf) {}
-
-    int edgeLength() const {
-        return *end - start + 1;
-    }
-};
+namespace checker_five {
 
 class SimpleNode{
 public:
@@ -109,66 +97,30 @@ public:
 class SuffixTree {
     // Implementation of this is based on Ukkonen's algorithm. I have referred to the implementation specified in https://www.geeksforgeeks.org/ukkonens-suffix-tree-construction-part-6/ and https://cp-algorithms.com/string/suffix-tree-ukkonen.html
     // Longest Common Substring is based on the algorithm explained in Wikipedia and on https://www.geeksforgeeks.org/suffix-tree-application-5-longest-common-substring-2/
+    // Nodes are indices into parallel arrays, and all edges live in one hashed table keyed by (parent, first token),
+    // with a list of edges per node for the depth-first passes. Leaves share the global end leafEnd through the
+    // OPEN_END marker. The whole tree is a few vectors, released together when the tree goes away.
     public:
 
-    TrieNode* root;
-    TrieNode* activeNode;
-    TrieNode* lastNewNode;
-
-    NotAcceptingTrie* not_accepted_trie;
-
-    int activeEdge;
-    int activeLength;
-
-    int remainingSuffixCount;
-    std::shared_ptr<int> leafEnd;
-    std::unordered_map<int, int> children;
-
-    std::shared_ptr<int> rootEnd;
-    std::shared_ptr<int> splitEnd;
-    int count;
-    int size;
-
-    std::vector<int> sequence;
-
     SuffixTree(const std::vector<int>& submission);
 
-    ~SuffixTree();
-
-    TrieNode* generateNewNode(int start, std::shared_ptr<int> end);
-    
-    bool walkDown(TrieNode* node);
-
-    void extendSuffixTree(int position);
-
-    void freeSuffixTreeByPostOrder(TrieNode* node);
-
-    void setSuffixIndexByDFS(TrieNode* node, int label_height);
-
-    void setNumberOfOccurencesByDFS(TrieNode* node);
-
-    std::pair<int, int> deterministic_check(const std::vector<int>& submission2, std::vector<bool> plag_flags){
+    std::pair<int, int> deterministic_check(const std::vector<int>& submission2, std::vector<bool> plag_flags) const {
         // The algorithm works as follows: For every substring of length 10, if it matches with a substring in the base suffix tree, 
         // If it does match, we add the substring to a trie containing the sequences (and their respective counts) which should not be matched anymore
         // If the same sequence is seen again, decrement its count in the trie. For as long as the count is non-zero, we can "accept" the sequence
         // If the count becomes 0, reject the sequence whenever it occurs again
         // Here, on a rejection, the double-counting array comes into play, to ensure that we don't skip valid sequences but also that if an element is forced to map to a pattern which has already been used up,
         // we don't consider it as a new pattern but as a "double count"
+        // The trie is per check, so the tree itself is never modified and can be shared between checks.
+        NotAcceptingTrie not_accepted_trie;
         std::vector<bool> double_count_flags(plag_flags.size(), false);
-        int start=0;
         int end=0;
         int gap=10;
         for (int i = 0; i + gap <= submission2.size(); i++){
             end=deterministic_check_from_starting_pos(submission2, i);
             if (end == 0) continue;
-            // std::cout << end << "\n";
-            if (!not_accepted_trie->check_if_present(std::vector<int>(submission2.begin()+i, submission2.begin()+i+gap))){
-                // std::cout << "Accepted: ";
-                // for (int j=i; j<i+gap; j++){
-                //     std::cout << submission2[j] << " ";
-                // }
-                // std::cout << "\n";
-                not_accepted_trie->insert(std::vector<int>(submission2.begin()+i, submission2.begin()+i+gap), end-1);
+            if (!not_accepted_trie.check_if_present(std::vector<int>(submission2.begin()+i, submission2.begin()+i+gap))){
+                not_accepted_trie.insert(std::vector<int>(submission2.begin()+i, submission2.begin()+i+gap), end-1);
                 for (int j=i; j<i+gap; j++){
                     plag_flags[j]=true;
                 }
@@ -178,11 +130,6 @@ class SuffixTree {
                     plag_flags[j]=true;
                     double_count_flags[j]=true;
                 }
-                // std::cout << "Rejected: ";
-                // for (int j=i; j<i+gap; j++){
-                //     std::cout << submission2[j] << " ";
-                // }
-                // std::cout << "\n";
             }
         }
         int plag_count=0;
@@ -203,102 +150,153 @@ class SuffixTree {
             }
         }
         max_longest=std::max(max_longest, longest);
-        // std::cout << "Longest non-exact match found: " << max_longest << "\n";
         return {plag_count, max_longest};
     }
 
-    int deterministic_check_from_starting_pos(const std::vector<int>& submission2, int starting_pos){
-        TrieNode* current=root;
-        if (current->children.find(submission2[starting_pos])==current->children.end()){
+    int deterministic_check_from_starting_pos(const std::vector<int>& submission2, int starting_pos) const {
+        int current=findChild(ROOT, submission2[starting_pos]);
+        if (current == NO_NODE){
             return 0;
         }
-        current=current->children[submission2[starting_pos]];
         int i=starting_pos;
-        int start=current->start;
-        int end=*current->end;
+        int start=nodeStart[current];
+        int end=edgeEnd(current);
         while(true){
             while (i<submission2.size() && start<=end && submission2[i]==sequence[start]){
                 i++;
                 if (i==starting_pos+10){
-                    return current->children_count;
+                    return childrenCount[current];
                 }
                 start++;
             }
             if (i==submission2.size() || i==starting_pos+10){
-                return current->children_count;
+                return childrenCount[current];
             }
-            if (start <= end || current->children.find(submission2[i])==current->children.end()){
+            if (start <= end){
                 return 0;
             }
-            current=current->children[submission2[i]];
-            start=current->start;
-            end=*current->end;
-        }
-    }
-
-    int traverse(TrieNode* node, int labelHeight, int* max_lenght){
-        // Recursion to set flags (stored in the suffixIndex variable) to determine whether a particular node has children corresponding to both vector 1 and vector 2, only vector 1, only vector 2 or no children.
-        if (node == nullptr){
-            return 0;
-        }
-        int i = 0;
-        int ret=-1;
-        if (node->suffixIndex < 0){
-            for (auto child : node->children){
-                ret=traverse(child.second, labelHeight + child.second->edgeLength(), max_lenght);
-                if (node->suffixIndex == -1){
-                    node->suffixIndex = ret;
-                }
-                else if ((node->suffixIndex == -2 && ret == -3) || (node->suffixIndex == -3 && ret == -2) || (node->suffixIndex == -4)){
-                    node->suffixIndex = -4;
-                    if (labelHeight > *max_lenght){
-                        *max_lenght = labelHeight;
-                    }
-                }
+            current=findChild(current, submission2[i]);
+            if (current == NO_NODE){
+                return 0;
             }
+            start=nodeStart[current];
+            end=edgeEnd(current);
         }
-        else if (node->suffixIndex > -1 && node->suffixIndex < size){
-            return -2;
-        }
-        else if (node->suffixIndex >= size){
-            return -3;
-        }
-        return node->suffixIndex;
     }
 
-    int longest_perfect_match(const std::vector<int>& submission2){
-        // Creates the generalized suffix tree and calls traverse() on the same, assuming that -1 and -2 are distinguished values which can never be part of the tokens
-        int original_size=sequence.size();
-        sequence.push_back(-1);
-        for (int i=0; i<submission2.size(); i++){
-            sequence.push_back(submission2[i]);
-        }
-        sequence.push_back(-2);
-        for (int i=original_size; i<sequence.size(); i++){
-            extendSuffixTree(i);
-        }
-        setSuffixIndexByDFS(root, 0);
+    private:
+
+    static constexpr int ROOT = 0;
+    static constexpr int NO_NODE = -1;
+    static constexpr int OPEN_END = std::numeric_limits<int>::max(); // End of every leaf: leafEnd.
+    static constexpr std::uint64_t EMPTY_SLOT = ~std::uint64_t(0);
 
-        int max_length=0;
+    int generateNewNode(int start, int end);
 
-        traverse(root, 0, &max_length);
-        // std::cout << "Longest perfect match: " << max_length << "\n";
-        return max_length;
+    int edgeEnd(int node) const {
+        return nodeEnd[node] == OPEN_END ? leafEnd : nodeEnd[node];
     }
+
+    int edgeLength(int node) const {
+        return edgeEnd(node) - nodeStart[node] + 1;
+    }
+
+    static std::uint64_t edgeKey(int node, int token) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(node)) << 32) | static_cast<std::uint32_t>(token);
+    }
+
+    std::size_t slotOf(std::uint64_t key) const;
+
+    int findChild(int node, int token) const;
+
+    void setChild(int node, int token, int child);
+
+    bool walkDown(int node);
+
+    void extendSuffixTree(int position);
+
+    std::vector<int> preorder() const;
+
+    void setNumberOfOccurencesByDFS();
+
+    // Per node.
+    std::vector<int> nodeStart;
+    std::vector<int> nodeEnd;
+    std::vector<int> suffixLink;
+    std::vector<int> childrenCount;
+    std::vector<int> firstEdge;
+    // Per edge: the child it leads to and the next edge of the same parent.
+    std::vector<int> edgeChild;
+    std::vector<int> edgeNext;
+    // Open-addressing table from edgeKey(parent, first token) to edge.
+    std::vector<std::uint64_t> slotKeys;
+    std::vector<int> slotEdges;
+
+    int activeNode;
+    int activeEdge;
+    int activeLength;
+    int lastNewNode;
+    int remainingSuffixCount;
+    int leafEnd;
+
+    std::vector<int> sequence;
 };
 
-    TrieNode* SuffixTree::generateNewNode(int start, std::shared_ptr<int> end) {
-        count++;
-        TrieNode* node = new TrieNode(start, end);
-        node->suffixLink = root;
-        node->suffixIndex = -1;
-        return node;
+    int SuffixTree::generateNewNode(int start, int end) {
+        nodeStart.push_back(start);
+        nodeEnd.push_back(end);
+        suffixLink.push_back(ROOT);
+        childrenCount.push_back(0);
+        firstEdge.push_back(-1);
+        return nodeStart.size() - 1;
+    }
+
+    std::size_t SuffixTree::slotOf(std::uint64_t key) const {
+        std::size_t mask = slotKeys.size() - 1;
+        std::size_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+        while (slotKeys[slot] != key && slotKeys[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    int SuffixTree::findChild(int node, int token) const {
+        std::size_t slot = slotOf(edgeKey(node, token));
+        return slotKeys[slot] == EMPTY_SLOT ? NO_NODE : edgeChild[slotEdges[slot]];
     }
 
-    bool SuffixTree::walkDown(TrieNode* node) {
-        if (activeLength >= node->edgeLength()) {
-            activeEdge += node->edgeLength(); 
-            activeLength -= node->edgeLength();
+    void SuffixTree::setChild(int node, int token, int child) {
+        std::uint64_t key = edgeKey(node, token);
+        std::size_t slot = slotOf(key);
+        if (slotKeys[slot] == key) {
+            edgeChild[slotEdges[slot]] = child;
+            return;
+        }
+        edgeChild.push_back(child);
+        edgeNext.push_back(firstEdge[node]);
+        firstEdge[node] = edgeChild.size() - 1;
+        slotKeys[slot] = key;
+        slotEdges[slot] = edgeChild.size() - 1;
+        if (2 * edgeChild.size() > slotKeys.size()) {
+            // Keep the load under one half; rehash every edge into a table twice as large.
+            std::vector<std::uint64_t> keys(2 * slotKeys.size(), EMPTY_SLOT);
+            std::vector<int> edges(keys.size());
+            std::swap(keys, slotKeys);
+            std::swap(edges, slotEdges);
+            for (std::size_t old = 0; old < keys.size(); ++old) {
+                if (keys[old] != EMPTY_SLOT) {
+                    std::size_t moved = slotOf(keys[old]);
+                    slotKeys[moved] = keys[old];
+                    slotEdges[moved] = edges[old];
+                }
+            }
+        }
+    }
+
+    bool SuffixTree::walkDown(int node) {
+        if (activeLength >= edgeLength(node)) {
+            activeEdge += edgeLength(node); 
+            activeLength -= edgeLength(node);
             activeNode = node;
             return true;
         }
@@ -306,77 +304,60 @@ class SuffixTree {
     }
 
     void SuffixTree::extendSuffixTree(int position) {
-        // std::cout << std::make_shared<int>(leafEnd) << " " << &leafEnd << "\n";
-        *leafEnd = position; 
+        leafEnd = position; 
         remainingSuffixCount++;
-        lastNewNode = nullptr;
+        lastNewNode = NO_NODE;
         
         while (remainingSuffixCount > 0) {
             if (activeLength == 0) {
                 activeEdge = position;
             }
 
-            int edgeKey = sequence[activeEdge];
-            if (activeNode->children.find(edgeKey) == activeNode->children.end()) {
-                activeNode->children[edgeKey] = generateNewNode(position, leafEnd); 
-                if (lastNewNode != nullptr) {
-                    lastNewNode->suffixLink = activeNode;
-                    lastNewNode = nullptr;
+            int edgeToken = sequence[activeEdge];
+            int next = findChild(activeNode, edgeToken);
+            if (next == NO_NODE) {
+                setChild(activeNode, edgeToken, generateNewNode(position, OPEN_END)); 
+                if (lastNewNode != NO_NODE) {
+                    suffixLink[lastNewNode] = activeNode;
+                    lastNewNode = NO_NODE;
                 }
             } else {
-                TrieNode* next = activeNode->children[edgeKey];
                 if (walkDown(next)) {
                     continue;
                 }
 
-                if (sequence[next->start + activeLength] == sequence[position]) {
-                    if (lastNewNode != nullptr && activeNode != root) {
-                        lastNewNode->suffixLink = activeNode;
-                        lastNewNode = nullptr;
+                if (sequence[nodeStart[next] + activeLength] == sequence[position]) {
+                    if (lastNewNode != NO_NODE && activeNode != ROOT) {
+                        suffixLink[lastNewNode] = activeNode;
+                        lastNewNode = NO_NODE;
                     }
                     activeLength++;
                     break;
                 }
 
-                auto splitEndPtr = std::make_shared<int>(next->start + activeLength - 1);
-                TrieNode* split = generateNewNode(next->start, splitEndPtr);
-                activeNode->children[edgeKey] = split;
+                int split = generateNewNode(nodeStart[next], nodeStart[next] + activeLength - 1);
+                setChild(activeNode, edgeToken, split);
 
-                split->children[sequence[position]] = generateNewNode(position, leafEnd); 
-                next->start += activeLength;
-                split->children[sequence[next->start]] = next;
+                setChild(split, sequence[position], generateNewNode(position, OPEN_END)); 
+                nodeStart[next] += activeLength;
+                setChild(split, sequence[nodeStart[next]], next);
 
-                if (lastNewNode != nullptr) {
-                    lastNewNode->suffixLink = split;
+                if (lastNewNode != NO_NODE) {
+                    suffixLink[lastNewNode] = split;
                 }
                 lastNewNode = split;
             }
 
             remainingSuffixCount--;
-            if (activeNode == root && activeLength > 0) {
+            if (activeNode == ROOT && activeLength > 0) {
                 activeLength--;
                 activeEdge = position - remainingSuffixCount + 1;
-            } else if (activeNode != root) {
-                activeNode = activeNode->suffixLink;
+            } else if (activeNode != ROOT) {
+                activeNode = suffixLink[activeNode];
             }
         }
     }
 
-    void SuffixTree::freeSuffixTreeByPostOrder(TrieNode* node) {
-        if (node == nullptr) {
-            return;
-        }
-        for (auto& child : node->children) {
-            freeSuffixTreeByPostOrder(child.second);
-        }
-        delete node;
-    }
-
-    SuffixTree::~SuffixTree() {
-        freeSuffixTreeByPostOrder(root);
-        delete not_accepted_trie;
-    }
-
     SuffixTree::SuffixTree(const std::vector<int>& submission) {
         for (int a : submission) {
             sequence.push_back(a);
@@ -384,119 +365,288 @@ class SuffixTree {
         activeEdge = -1;
         activeLength = 0;
         remainingSuffixCount = 0;
-        leafEnd = std::make_shared<int>(-1);
-        lastNewNode = nullptr;
-        count = 0;
-
-        rootEnd = std::make_shared<int>(-1);
-        root = generateNewNode(-1, rootEnd); 
-        activeNode = root;
-        size=sequence.size();
+        leafEnd = -1;
+        lastNewNode = NO_NODE;
+
+        // A suffix tree has at most 2n nodes; reserving avoids regrowing the arrays.
+        std::size_t capacity = 2 * sequence.size() + 2;
+        for (std::vector<int>* column : {&nodeStart, &nodeEnd, &suffixLink, &childrenCount, &firstEdge, &edgeChild, &edgeNext}) {
+            column->reserve(capacity);
+        }
+        std::size_t slots = 16;
+        while (slots < 2 * capacity) {
+            slots *= 2;
+        }
+        slotKeys.assign(slots, EMPTY_SLOT);
+        slotEdges.assign(slots, -1);
+
+        activeNode = generateNewNode(-1, -1);
         
         for (int i = 0; i < sequence.size(); i++) {
             extendSuffixTree(i);
         }
-        setSuffixIndexByDFS(root, 0);
-        setNumberOfOccurencesByDFS(root);
-        not_accepted_trie = new NotAcceptingTrie();
+        setNumberOfOccurencesByDFS();
     }
 
-    void SuffixTree::setSuffixIndexByDFS(TrieNode* node, int label_height) {
-        if (node == nullptr) {
-            return;
-        }
-        int leaf = 1;
-        for (auto child : node->children) {
-            leaf = 0;
-            setSuffixIndexByDFS(child.second, label_height + child.second->edgeLength());
-        }
-        if (leaf == 1) {
-            node->suffixIndex = sequence.size() - label_height;
-            // std::cout << node->suffixIndex << "\n";
-        }
-        else {
-            node->suffixIndex = -1;
+    std::vector<int> SuffixTree::preorder() const {
+        // Nodes with every parent before its children.
+        std::vector<int> order;
+        order.reserve(nodeStart.size());
+        order.push_back(ROOT);
+        for (std::size_t k = 0; k < order.size(); ++k) {
+            for (int edge = firstEdge[order[k]]; edge != -1; edge = edgeNext[edge]) {
+                order.push_back(edgeChild[edge]);
+            }
         }
+        return order;
     }
 
-    void SuffixTree::setNumberOfOccurencesByDFS(TrieNode* node) {
-        if (node == nullptr) {
-            return;
-        }
-        int leaf = 1;
-        for (auto child : node->children) {
-            leaf = 0;
-            setNumberOfOccurencesByDFS(child.second);
-        }
-        if (leaf == 1) {
-            node->children_count = 1;
-        } else {
-            node->children_count = 0;
-            for (auto child : node->children) {
-                node->children_count += child.second->children_count;
+    void SuffixTree::setNumberOfOccurencesByDFS() {
+        std::vector<int> order = preorder();
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            int node = *it;
+            if (firstEdge[node] == -1) {
+                childrenCount[node] = 1;
+            } else {
+                childrenCount[node] = 0;
+                for (int edge = firstEdge[node]; edge != -1; edge = edgeNext[edge]) {
+                    childrenCount[node] += childrenCount[edgeChild[edge]];
+                }
             }
         }
     }
 
+// Tables with fewer cells than this are filled on the calling thread; splitting them costs more than it saves.
+constexpr long long PARALLEL_MIN_CELLS = 1LL << 22;
+constexpr int MIN_STRIP_WIDTH = 256;
+
+// Threads one comparison may use, 0 for every core. A caller that already spreads comparisons over a
+// pool of its own gives each its share of the cores, or the strips and stages of all the workers add up
+// to about cores * cores threads.
+std::atomic<unsigned> thread_budget{0};
+
+void set_thread_budget(unsigned threads) {
+    thread_budget.store(threads, std::memory_order_relaxed);
+}
+
+unsigned available_threads(void) {
+    unsigned budget = thread_budget.load(std::memory_order_relaxed);
+    return budget > 0 ? budget : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Number of column strips, and so threads, for a table of rows x columns cells.
+int strip_count(long long rows, long long columns) {
+    if (rows * columns < PARALLEL_MIN_CELLS) {
+        return 1;
+    }
+    long long threads = available_threads();
+    return static_cast<int>(std::max(1LL, std::min(threads, columns / MIN_STRIP_WIDTH)));
+}
+
+// Runs a dynamic program over rows 1..rows and columns 1..columns whose cells depend on the cells
+// to their left, above and upper left. The columns are split into strips, each filled top to bottom
+// by its own thread in blocks of rows; strip t starts a block once strip t - 1 has finished it, so
+// the blocks on an anti-diagonal run at the same time. process(strip, first_column, last_column,
+// first_row, last_row) fills one block, and gets the whole table when there is a single strip.
+template <typename Process>
+void wavefront(int rows, int columns, int strips, Process process) {
+    auto first_column = [&](int t) { return 1 + static_cast<int>(static_cast<long long>(columns) * t / strips); };
+    if (strips <= 1) {
+        process(0, 1, columns, 1, rows);
+        return;
+    }
+    // Enough blocks per strip that the pipeline is full most of the time.
+    int height = std::clamp(rows / (4 * strips), 4, 64);
+    int blocks = (rows + height - 1) / height;
+    std::vector<std::atomic<int>> finished(strips); // Blocks done per strip.
+    auto run = [&](int t) {
+        for (int b = 0; b < blocks; ++b) {
+            if (t > 0) {
+                for (int seen = finished[t - 1].load(std::memory_order_acquire); seen <= b;
+                     seen = finished[t - 1].load(std::memory_order_acquire)) {
+                    finished[t - 1].wait(seen, std::memory_order_acquire);
+                }
+            }
+            process(t, first_column(t), first_column(t + 1) - 1, 1 + b * height, std::min(rows, (b + 1) * height));
+            finished[t].store(b + 1, std::memory_order_release);
+            finished[t].notify_one();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < strips; ++t) {
+        pool.emplace_back(run, t);
+    }
+    run(0);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+// Fills rows first_row + 1 .. last_row of the Smith-Waterman score matrix H, over
+// columns 0 .. width - 1, from row first_row held at the start of block.
+// Row r of the block starts at (r - first_row) * width.
+void smith_waterman_rows(const std::vector<int>& s1, const std::vector<int>& s2, int match, int gap,
+                         int first_row, int last_row, int width, std::vector<int>& block) {
+    block.resize(static_cast<std::size_t>(last_row - first_row + 1) * width);
+    for (int i = first_row + 1; i <= last_row; ++i) {
+        block[static_cast<std::size_t>(i - first_row) * width] = 0;
+    }
+    int rows = last_row - first_row;
+    // Strips read the cells to their left straight from the block.
+    wavefront(rows, width - 1, strip_count(rows, width - 1), [&](int, int first_column, int last_column, int r0, int r1) {
+        for (int i = first_row + r0; i <= first_row + r1; ++i) {
+            const int* up = block.data() + static_cast<std::size_t>(i - 1 - first_row) * width;
+            int* row = block.data() + static_cast<std::size_t>(i - first_row) * width;
+            for (int j = first_column; j <= last_column; ++j) {
+                int score_diag = (s1[i - 1] == s2[j - 1]) ? up[j - 1] + match : 0;
+                row[j] = std::max({0, score_diag, up[j] + gap, row[j - 1] + gap});
+            }
+        }
+    });
+}
+
 std::vector<std::tuple<int, double, int, int>> smith_waterman_80_similarity(const std::vector<int>& s1, const std::vector<int>& s2, int match = 3, int gap = -2, const std::vector<double>& thresholds={0.8}) {
     // This algorithm, commonly used in bioinformatics, is used to find a location with high local alignment.
     // I am using extra 2D vectors in order to carry out the check for a particular location having a greater than 80% match before potentially changing the max_index.
+    // Only two rows of H, H2, L1 and L2 are live at a time. The values of H2, L1 and L2 at each end position are kept
+    // as it is found, and every stride-th row of H is kept as a checkpoint, from which the traceback recomputes
+    // the rows it walks through. This keeps memory at O(n sqrt(m)) instead of four m x n matrices.
+    // On large tables each strip of columns keeps its own two rows, and the strips run as a wavefront.
     assert(std::abs(thresholds[0]-0.8)<1e-3);
     int m = s1.size(), n = s2.size();
-    std::vector<std::vector<int>> H(m + 1, std::vector<int>(n + 1, 0));
-    std::vector<std::vector<int>> L1(m + 1, std::vector<int>(n + 1, 0));
-    std::vector<std::vector<int>> H2(m + 1, std::vector<int>(n + 1, 0));
-    std::vector<std::vector<int>> L2(m + 1, std::vector<int>(n + 1, 0));
-    std::vector<int> max_scores(thresholds.size(), 0);
-    std::vector<std::pair<int, int>> end_pos(thresholds.size(), {-1, -1});
+    int stride = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(m))));
+    std::vector<int> checkpoints(static_cast<std::size_t>(m / stride + 1) * (n + 1), 0);
+    // The best end position per threshold found by one strip of columns, with H2, L1 and L2 there.
+    struct Best {
+        int length = 0;
+        int i = -1, j = -1;
+        int H2 = 0, L1 = 0, L2 = 0;
+    };
+    // Per strip, rows over its columns plus the column left of it at index 0.
+    struct Strip {
+        std::vector<int> H_prev, H_cur, H2_prev, H2_cur, L1_prev, L1_cur, L2_prev, L2_cur;
+        std::vector<Best> best;
+    };
+    // H, H2, L1 and L2 down the last column of each strip, read by the strip to its right.
+    struct Edge {
+        std::vector<int> H, H2, L1, L2;
+    };
+    int strips = strip_count(m, n);
+    std::vector<Strip> state(strips);
+    std::vector<Edge> edges(strips);
+    for (int t = 0; t < strips; ++t) {
+        int width = static_cast<int>(static_cast<long long>(n) * (t + 1) / strips - static_cast<long long>(n) * t / strips);
+        for (std::vector<int>* row : {&state[t].H_prev, &state[t].H_cur, &state[t].H2_prev, &state[t].H2_cur,
+                                      &state[t].L1_prev, &state[t].L1_cur, &state[t].L2_prev, &state[t].L2_cur}) {
+            row->assign(width + 1, 0);
+        }
+        state[t].best.resize(thresholds.size());
+        if (t > 0) {
+            for (std::vector<int>* column : {&edges[t].H, &edges[t].H2, &edges[t].L1, &edges[t].L2}) {
+                column->assign(m + 1, 0);
+            }
+        }
+    }
 
-    for (int i = 1; i <= m; ++i) {
-        for (int j = 1; j <= n; ++j) {
-            int score_diag = (s1[i - 1] == s2[j - 1]) ? H[i - 1][j - 1] + match : 0;
+    wavefront(m, n, strips, [&](int t, int first_column, int last_column, int first_row, int last_row) {
+        Strip& strip = state[t];
+        std::vector<int>& H_prev = strip.H_prev; std::vector<int>& H_cur = strip.H_cur;
+        std::vector<int>& H2_prev = strip.H2_prev; std::vector<int>& H2_cur = strip.H2_cur;
+        std::vector<int>& L1_prev = strip.L1_prev; std::vector<int>& L1_cur = strip.L1_cur;
+        std::vector<int>& L2_prev = strip.L2_prev; std::vector<int>& L2_cur = strip.L2_cur;
+        int width = last_column - first_column + 1;
+        for (int i = first_row; i <= last_row; ++i) {
+            if (t > 0) {
+                H_cur[0] = edges[t].H[i];
+                H2_cur[0] = edges[t].H2[i];
+                L1_cur[0] = edges[t].L1[i];
+                L2_cur[0] = edges[t].L2[i];
+            }
+            for (int x = 1; x <= width; ++x) {
+                int j = first_column + x - 1;
+                int score_diag = (s1[i - 1] == s2[j - 1]) ? H_prev[x - 1] + match : 0;
 
-            int score_up = H[i - 1][j] + gap;
+                int score_up = H_prev[x] + gap;
 
-            int score_left = H[i][j - 1] + gap;
+                int score_left = H_cur[x - 1] + gap;
 
-            H[i][j] = std::max({0, score_diag, score_up, score_left});
+                H_cur[x] = std::max({0, score_diag, score_up, score_left});
 
-            if (H[i][j] == 0){
-                H2[i][j] = 0;
-                L1[i][j] = 0;
-                L2[i][j] = 0;
-            }
-            else {
-                if (H[i][j] == score_diag){
-                    H2[i][j] = H2[i - 1][j - 1] + 1;
-                    L1[i][j] = L1[i - 1][j - 1] + 1;
-                    L2[i][j] = L2[i - 1][j - 1] + 1;
-                }
-                else if (H[i][j] == score_up){
-                    H2[i][j] = H2[i-1][j];
-                    L1[i][j] = L1[i-1][j] + 1;
-                    L2[i][j] = L2[i-1][j];
+                if (H_cur[x] == 0){
+                    H2_cur[x] = 0;
+                    L1_cur[x] = 0;
+                    L2_cur[x] = 0;
                 }
                 else {
-                    H2[i][j] = H2[i][j-1];
-                    L1[i][j] = L1[i][j-1];
-                    L2[i][j] = L2[i][j-1]+1;
+                    if (H_cur[x] == score_diag){
+                        H2_cur[x] = H2_prev[x - 1] + 1;
+                        L1_cur[x] = L1_prev[x - 1] + 1;
+                        L2_cur[x] = L2_prev[x - 1] + 1;
+                    }
+                    else if (H_cur[x] == score_up){
+                        H2_cur[x] = H2_prev[x];
+                        L1_cur[x] = L1_prev[x] + 1;
+                        L2_cur[x] = L2_prev[x];
+                    }
+                    else {
+                        H2_cur[x] = H2_cur[x-1];
+                        L1_cur[x] = L1_cur[x-1];
+                        L2_cur[x] = L2_cur[x-1]+1;
+                    }
+                }
+                if (H_cur[x] == 0) {
+                    continue;
+                }
+                int length = std::max(L1_cur[x], L2_cur[x]);
+                double similarity = static_cast<double>(H2_cur[x]) / length;
+                for (int k = 0; k < thresholds.size(); k++){
+                    double threshold = thresholds[k];
+                    Best& best = strip.best[k];
+                    if (similarity >= threshold && length >= best.length) {
+                        best = {length, i, j, H2_cur[x], L1_cur[x], L2_cur[x]};
+                    }
                 }
             }
-            double similarity = static_cast<double>(H2[i][j]) / std::max(L1[i][j], L2[i][j]);
-            if (H[i][j] == 0) {
-                continue;
+            if (t + 1 < strips) {
+                edges[t + 1].H[i] = H_cur[width];
+                edges[t + 1].H2[i] = H2_cur[width];
+                edges[t + 1].L1[i] = L1_cur[width];
+                edges[t + 1].L2[i] = L2_cur[width];
             }
-            for (int k = 0; k < thresholds.size(); k++){
-                double threshold = thresholds[k];
-                if (similarity >= threshold && std::max(L1[i][j], L2[i][j]) >= max_scores[k]) {
-                    max_scores[k] = std::max(L1[i][j], L2[i][j]);
-                    end_pos[k] = {i, j};
-                }
+            if (i % stride == 0) {
+                std::copy(H_cur.begin() + 1, H_cur.end(),
+                          checkpoints.begin() + static_cast<std::size_t>(i / stride) * (n + 1) + first_column);
             }
+            std::swap(H_prev, H_cur);
+            std::swap(H2_prev, H2_cur);
+            std::swap(L1_prev, L1_cur);
+            std::swap(L2_prev, L2_cur);
         }
+    });
+
+    // Scanning row by row, the end position is the last cell of greatest length, so of the strips'
+    // bests the one with the greatest (length, i, j).
+    std::vector<int> max_scores(thresholds.size(), 0);
+    std::vector<std::pair<int, int>> end_pos(thresholds.size(), {-1, -1});
+    // H2, L1 and L2 at end_pos[k].
+    std::vector<int> end_H2(thresholds.size(), 0), end_L1(thresholds.size(), 0), end_L2(thresholds.size(), 0);
+    for (int k = 0; k < thresholds.size(); k++){
+        Best chosen;
+        for (const Strip& strip : state) {
+            const Best& best = strip.best[k];
+            if (std::tie(best.length, best.i, best.j) > std::tie(chosen.length, chosen.i, chosen.j)) {
+                chosen = best;
+            }
+        }
+        max_scores[k] = chosen.length;
+        end_pos[k] = {chosen.i, chosen.j};
+        end_H2[k] = chosen.H2;
+        end_L1[k] = chosen.L1;
+        end_L2[k] = chosen.L2;
     }
     std::unordered_map<int, std::pair<int, int>> end_pos_map;
     std::vector<double> similarities(thresholds.size(), 0.0);
+    std::vector<int> block;
     for (int k = 0; k < thresholds.size(); k++){
         int matches=0;
         int alignment_length=0;
@@ -505,16 +655,35 @@ std::vector<std::tuple<int, double, int, int>> smith_waterman_80_similarity(cons
 
         int i = end_pos[k].first, j = end_pos[k].second;
         if (end_pos_map.find(end_pos[k].first*(n+1)+end_pos[k].second) != end_pos_map.end()){
-            max_scores[k] = std::max(L1[end_pos[k].first][end_pos[k].second], L2[end_pos[k].first][end_pos[k].second]);
-            similarities[k] = static_cast<double>(H2[end_pos[k].first][end_pos[k].second]) / std::max(L1[end_pos[k].first][end_pos[k].second], L2[end_pos[k].first][end_pos[k].second]);
+            max_scores[k] = std::max(end_L1[k], end_L2[k]);
+            similarities[k] = max_scores[k] > 0 ? static_cast<double>(end_H2[k]) / max_scores[k] : 0.0;
             end_pos[k] = end_pos_map[end_pos[k].first*(n+1)+end_pos[k].second];
             continue;
         }
-        while (i > 0 && j > 0 && H[i][j] > 0) {
+        // H over columns 0..end column, rows block_first..block_first + stride, rebuilt
+        // from the checkpoint below whenever the walk needs a row above those it holds.
+        int width = j + 1;
+        int block_first = -1;
+        auto load = [&](int row) {
+            if (block_first < 0 || row - 1 < block_first) {
+                block_first = (row - 1) / stride * stride;
+                const int* checkpoint = checkpoints.data() + static_cast<std::size_t>(block_first / stride) * (n + 1);
+                block.assign(checkpoint, checkpoint + width);
+                smith_waterman_rows(s1, s2, match, gap, block_first, std::min(block_first + stride, m), width, block);
+            }
+        };
+        auto H = [&](int row, int column) {
+            return block[static_cast<std::size_t>(row - block_first) * width + column];
+        };
+        while (i > 0 && j > 0) {
+            load(i);
+            if (H(i, j) <= 0) {
+                break;
+            }
             if (s1[i - 1] == s2[j - 1]) {
                 i--; j--;
                 matches++;
-            } else if (H[i - 1][j] + gap == H[i][j]) {
+            } else if (H(i - 1, j) + gap == H(i, j)) {
                 i--;
                 num_gaps1++;
             } else {
@@ -527,7 +696,6 @@ std::vector<std::tuple<int, double, int, int>> smith_waterman_80_similarity(cons
         double similarity = alignment_length > 0 ? static_cast<double>(matches) / alignment_length : 0.0;
         similarities[k] = similarity;
         end_pos_map[end_pos[k].first*(n+1)+end_pos[k].second] = {i, j};
-        // std::cout << "Alignment length: " << alignment_length << " Matches: " << matches << " Gaps: " << num_gaps1 << " " << num_gaps2 << " " << std::max(L1[end_pos[k].first][end_pos[k].second], L2[end_pos[k].first][end_pos[k].second]) << " " << H2[end_pos[k].first][end_pos[k].second] << "\n";
         end_pos[k] = {i, j};
     }
     std::vector<std::tuple<int, double, int, int>> res;
@@ -541,9 +709,6 @@ std::tuple<int, bool, int, int> levensthein_after_smith_waterman(const std::vect
     // After calling the smith_waterman algorithm with different treshholds, I am using the approx. starting indices identified by the algorithm to find the longest length match, starting from those indices
     // These heuristics together reduce the search space enough for my algorithm to be O(n^2), as opposed to O(n^4).
     std::vector<std::tuple<int, double, int, int>> res=smith_waterman_80_similarity(s1, s2, 3, -2, {0.8, 0.9, 0.95});
-    // for (auto r: res){
-    //     std::cout << std::get<0>(r) << " " << std::get<1>(r) << " " << std::get<2>(r) << " " << std::get<3>(r) << "\n";
-    // }
     int start_i=std::get<2>(res[0]);
     int start_j=std::get<3>(res[0]);   
     if (start_i == -1 || start_j == -1){
@@ -551,44 +716,90 @@ std::tuple<int, bool, int, int> levensthein_after_smith_waterman(const std::vect
     }
     int m=s1.size()-start_i;
     int n=s2.size()-start_j;
-    std::vector<std::vector<int>> dp(m+1, std::vector<int>(n+1, 0));
-    for (int i=0; i<=m; i++){
-        dp[i][0]=0;
-    }
-    for (int i=0; i<=n; i++){
-        dp[0][i]=0;
+    // dp is an LCS table, kept as two rows. A row is built in two passes: the first takes the
+    // diagonal on matches and the cell above otherwise, independently per column, and the
+    // second carries the maximum from the left. A match cell never loses to its neighbours,
+    // so this equals the usual recurrence. Large tables are split into strips of columns, each
+    // with its own two rows and its own max_length, and filled as a wavefront.
+    const int* row2 = s2.data() + start_j;
+    int strips = strip_count(m, n);
+    std::vector<std::vector<int>> previous(strips), current(strips);
+    std::vector<std::vector<int>> edges(strips); // dp down the column left of each strip.
+    std::vector<int> strip_max_length(strips, 0);
+    for (int t = 0; t < strips; ++t) {
+        int width = static_cast<int>(static_cast<long long>(n) * (t + 1) / strips - static_cast<long long>(n) * t / strips);
+        previous[t].assign(width + 1, 0);
+        current[t].assign(width + 1, 0);
+        if (t > 0) {
+            edges[t].assign(m + 1, 0);
+        }
     }
-    int max_length=0;
-    for (int i=1; i<=m; i++){
-        for (int j=1; j<=n; j++){
-            if (s1[start_i+i-1]==s2[start_j+j-1]){
-                dp[i][j]=dp[i-1][j-1]+1;
+    wavefront(m, n, strips, [&](int t, int first_column, int last_column, int first_row, int last_row) {
+        std::vector<int>& above = previous[t];
+        std::vector<int>& row = current[t];
+        int width = last_column - first_column + 1;
+        int& max_length = strip_max_length[t];
+        for (int i=first_row; i<=last_row; i++){
+            int token = s1[start_i+i-1];
+            if (t > 0) {
+                row[0] = edges[t][i];
             }
-            else {
-                dp[i][j]=std::max(dp[i-1][j], dp[i][j-1]);
+            for (int x=1; x<=width; x++){
+                row[x] = (token == row2[first_column+x-2]) ? above[x-1]+1 : above[x];
+            }
+            for (int x=1; x<=width; x++){
+                row[x] = std::max(row[x], row[x-1]);
+                // dp / max(i, j) >= 0.8, in integers.
+                int longer = std::max(i, first_column+x-1);
+                if (5 * row[x] >= 4 * longer && longer >= max_length){
+                    max_length = longer;
+                }
             }
-            if (static_cast<double>(dp[i][j])/std::max(i, j) >= 0.8 && std::max(i, j) >= max_length){
-                max_length=std::max(i, j);
+            if (t + 1 < strips) {
+                edges[t + 1][i] = row[width];
             }
+            std::swap(above, row);
         }
-    }
+    });
+    int max_length = *std::max_element(strip_max_length.begin(), strip_max_length.end());
     if (max_length < 30){
-        // std::cout << 0 << " " << 0 << " " << 0 << "\n";
-        // std::cout << 0 << " " << 0 << " " << 0 << " " << "\n";
         return {0,0,0,0};
     }
-    // std::cout << max_length << " " << std::get<0>(res[1]) << " " << std::get<0>(res[2]) << "\n";
     double percentage_overlap_80=static_cast<double>(max_length)/std::max(s1.size(), s2.size());
     double percentage_overlap_90=static_cast<double>(std::get<0>(res[1]))/std::max(s1.size(), s2.size());
     double percentage_overlap_95=static_cast<double>(std::get<0>(res[2]))/std::max(s1.size(), s2.size());
     bool result=((percentage_overlap_80>0.6)&&(percentage_overlap_90>0.15));
-    // std::cout << percentage_overlap_80 << " " << percentage_overlap_90 << " " << percentage_overlap_95 << " " << result << "\n";
     return {max_length, result, start_i, start_j};
 }
 
+// A submission with its suffix tree, built once by prepare() and shared by every compare() it takes part in.
+struct Prepared {
+    std::vector<int> tokens;
+    SuffixTree tree;
 
-std::array<int, 5> match_submissions(std::vector<int> &submission1, 
-        std::vector<int> &submission2) {
+    explicit Prepared(const std::vector<int>& submission) : tokens(submission), tree(submission) {}
+};
+
+std::shared_ptr<const Prepared> prepare(const std::vector<int>& submission) {
+    return std::make_shared<const Prepared>(submission);
+}
+
+// Runs task on a thread of its own for a pair large enough to be worth it, and otherwise (or with a
+// budget of one thread) on the calling thread once its result is asked for.
+template <typename Task>
+auto stage(std::size_t size1, std::size_t size2, Task task) {
+    bool parallel = static_cast<long long>(size1) * static_cast<long long>(size2) >= PARALLEL_MIN_CELLS
+                    && available_threads() > 1;
+    return std::async(parallel ? std::launch::async : std::launch::deferred, std::move(task));
+}
+
+using Alignment = std::tuple<int, bool, int, int>;
+
+// compare, with levensthein_after_smith_waterman of the pair already under way; the
+// deterministic checks and the longest common substring run alongside it.
+std::array<int, 5> compare_with_alignment(const Prepared& prepared1, const Prepared& prepared2, std::future<Alignment> alignment) {
+    const std::vector<int>& submission1 = prepared1.tokens;
+    const std::vector<int>& submission2 = prepared2.tokens;
     // std::ios_base::sync_with_stdio(false);
     // std::cin.tie(NULL);
     double start_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
@@ -605,20 +816,18 @@ std::array<int, 5> match_submissions(std::vector<int> &submission1,
     std::pair<int, int> res2;
     int longest_match=0;
     int longest_non_exact_match=0;
-    {
-        // Moving this to a separate scope so that immediately once the scope ends, the suffix trees can be destructed, thus saving memory.
-        SuffixTree tree1(submission1);
-        res1=tree1.deterministic_check(submission2, std::vector<bool>(submission2.size(), false));
-        // std::cout << "Deterministic Check results: " << res1.first << " ";
-        SuffixTree tree2(submission2);
-        res2=tree2.deterministic_check(submission1, std::vector<bool>(submission1.size(), false));
-        // std::cout << res2.first << "\n";
-        longest_non_exact_match=std::min(res1.second, res2.second);
-        // std::cout << "Longest non-exact match: " << std::min(res1.second, res2.second) << "\n";
-        longest_match=tree1.longest_perfect_match(submission2); 
-        // tree2.longest_perfect_match(submission1);
-    }
-    std::tuple<int, bool, int, int> res3=levensthein_after_smith_waterman(submission1, submission2);
+    auto check2 = stage(submission1.size(), submission2.size(), [&] {
+        return prepared2.tree.deterministic_check(submission1, std::vector<bool>(submission1.size(), false));
+    });
+    res1=prepared1.tree.deterministic_check(submission2, std::vector<bool>(submission2.size(), false));
+    // std::cout << "Deterministic Check results: " << res1.first << " ";
+    res2=check2.get();
+    // std::cout << res2.first << "\n";
+    longest_non_exact_match=std::min(res1.second, res2.second);
+    // std::cout << "Longest non-exact match: " << std::min(res1.second, res2.second) << "\n";
+    // The longest common substring, from the suffix and LCP arrays of the pair.
+    longest_match=suffix_array::pair_index_t(submission1, submission2).longest_common_substring().length;
+    std::tuple<int, bool, int, int> res3=alignment.get();
     // std::cout << std::get<0>(res3) << " " << std::get<1>(res3) << " " << std::get<2>(res3) << " " << std::get<3>(res3) << "\n";
     std::array<int, 5> result = {(std::get<1>(res3) || (longest_match >= 80 && longest_non_exact_match >= 90)), std::min(res1.first, res2.first), std::get<0>(res3), std::get<2>(res3), std::get<3>(res3)};
     double end_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
@@ -630,3 +839,44 @@ std::array<int, 5> match_submissions(std::vector<int> &submission1,
     return result; // dummy return
     // End TODO
 }
+
+std::array<int, 5> compare(const Prepared& prepared1, const Prepared& prepared2) {
+    const std::vector<int>& submission1 = prepared1.tokens;
+    const std::vector<int>& submission2 = prepared2.tokens;
+    return compare_with_alignment(prepared1, prepared2, stage(submission1.size(), submission2.size(), [&] {
+        return levensthein_after_smith_waterman(submission1, submission2);
+    }));
+}
+
+// Without a common window of 10 tokens the deterministic checks flag nothing and the longest exact match is
+// shorter than 80. An approximate match of 30 or more needs an LCS of 24 from the Smith-Waterman start, and
+// with fewer common tokens than that levensthein_after_smith_waterman finds none.
+std::optional<std::array<int, 5>> settle(const cascade::facts_t& facts) {
+    if (facts.shares_window || facts.common_tokens >= 24) {
+        return std::nullopt;
+    }
+    return std::array<int, 5>{0, 0, 0, 0, 0};
+}
+
+std::array<int, 5> match_submissions(std::vector<int> &submission1, 
+        std::vector<int> &submission2) {
+    if (std::optional<std::array<int, 5>> settled = cascade::try_settle(submission1, submission2, &settle)) {
+        return *settled;
+    }
+    // The alignment needs neither suffix tree, so on a large pair it runs while they are built.
+    auto alignment = stage(submission1.size(), submission2.size(), [&] {
+        return levensthein_after_smith_waterman(submission1, submission2);
+    });
+    auto prepared2 = stage(submission1.size(), submission2.size(), [&] { return prepare(submission2); });
+    std::shared_ptr<const Prepared> prepared1 = prepare(submission1);
+    return compare_with_alignment(*prepared1, *prepared2.get(), std::move(alignment));
+}
+
+} // namespace checker_five
+
+#ifndef CHECKER_REGISTRY
+std::array<int, 5> match_submissions(std::vector<int> &submission1, 
+        std::vector<int> &submission2) {
+    return checker_five::match_submissions(submission1, submission2);
+}
+#endif
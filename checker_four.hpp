@@ -7,13 +7,18 @@
 // #include <stdexcept>
 #include <algorithm> 
 #include <map>
-#define k 10 // for exact match
+#include <memory>
+#include "bit_parallel_lcs.hpp"
 
 // You are free to add any STL includes above this comment, below the --line--.
 // DO NOT add "using namespace std;" or include any other files/libraries.
 // Also DO NOT add the include "bits/stdc++.h"
 
 // OPTIONAL: Add your helper functions and data structures here
+namespace checker_four {
+
+constexpr int k = 10; // for exact match
+
 class Exact_Match{
     public:
         // returns hash values of the text
@@ -75,8 +80,13 @@ class Exact_Match{
         static int exact_match(std::vector<int> &text, std::vector<int> &pattern)
         {
             // calls the hash functions
-            std::map<int, std::vector<int>> text_hash = hash_text(text);
-            std::vector<int> pattern_hash = hash_pattern(pattern);
+            return exact_match(text, hash_text(text), pattern, hash_pattern(pattern));
+        }
+
+        // returns the length of the exact match, given the hashes of text and pattern
+        static int exact_match(const std::vector<int> &text, const std::map<int, std::vector<int>> &text_hash,
+                               const std::vector<int> &pattern, const std::vector<int> &pattern_hash)
+        {
             int p = pattern.size();
             int t = text.size();
 
@@ -90,9 +100,10 @@ class Exact_Match{
             {   
                 // matches the hash value of pattern and text
                 hashp = pattern_hash[i];
-                if (text_hash.find(hashp) != text_hash.end())
+                auto found = text_hash.find(hashp);
+                if (found != text_hash.end())
                 {
-                    std::vector<int> indices = text_hash[hashp];
+                    const std::vector<int>& indices = found->second;
                     int max = k;
                     int index = -1;
 
@@ -169,50 +180,15 @@ public:
     // This algorithm is inspired from GeeksForGeeks website "https://www.geeksforgeeks.org/longest-common-subsequence-dp-4/"
     static std::vector<int> findLCS(const std::vector<int> &vec1, const std::vector<int> &vec2)
     {
-        int m = vec1.size();
-        int n = vec2.size();
-
-        // dp[i][j] stores the length of LCS for vec1[0..i-1] and vec2[0..j-1]
-        std::vector<std::vector<int>> dp(m + 1, std::vector<int>(n + 1, 0));
-
-        // Fill dp table
-        for (int i = 1; i <= m; i++)
-        {
-            for (int j = 1; j <= n; j++)
-            {
-                if (vec1[i - 1] == vec2[j - 1])
-                {
-                    dp[i][j] = dp[i - 1][j - 1] + 1;
-                }
-                else
-                {
-                    dp[i][j] = std::max(dp[i - 1][j], dp[i][j - 1]);
-                }
-            }
-        }
-
-        // Reconstruct the LCS from dp table
-        std::vector<int> lcs;
-        int i = m, j = n;
+        // The bit-parallel kernel gives the pairs the dp table backtrack would,
+        // moving diagonally on matches and otherwise towards the larger value.
         std::vector<int> text_indices;
         std::vector<int> pat_indices;
-
-        while (i > 0 && j > 0)
+        for (auto [text_index, pat_index] : bit_parallel_lcs::alignment(vec1, vec2))
         {
-            // If current characters match, add to result
-            if (vec1[i - 1] == vec2[j - 1])
-            {   
-                text_indices.push_back(i-1);
-                pat_indices.push_back(j-1);
-                i--;
-                j--;
-            }
-            // Move in direction of larger value
-            else if (dp[i - 1][j] > dp[i][j - 1]) i--;
-            else j--;
+            text_indices.push_back(text_index);
+            pat_indices.push_back(pat_index);
         }
-        std::reverse(text_indices.begin(), text_indices.end());
-        std::reverse(pat_indices.begin(), pat_indices.end());
         return longest_80(text_indices,pat_indices);
     }
 };
@@ -244,15 +220,37 @@ int determine_plag_flag(int result1, int result2, int n1, int n2) {
     return (plag_conditions[0] || plag_conditions[1] || plag_conditions[2]) ? 1 : 0;
 }
 
-std::array<int, 5> match_submissions(std::vector<int> &submission1, std::vector<int> &submission2) {
+// Hashes of one submission for both roles it can take in exact_match: the text
+// (the larger submission) or the pattern. Built once by prepare() and shared by
+// every compare() the submission takes part in.
+struct Prepared {
+    std::vector<int> tokens;
+    std::map<int, std::vector<int>> text_hash;
+    std::vector<int> pattern_hash;
+};
+
+std::shared_ptr<const Prepared> prepare(const std::vector<int>& submission) {
+    auto prepared = std::make_shared<Prepared>();
+    prepared->tokens = submission;
+    // The hash functions need a full window.
+    if (submission.size() >= k) {
+        prepared->text_hash = Exact_Match::hash_text(submission);
+        prepared->pattern_hash = Exact_Match::hash_pattern(prepared->tokens);
+    }
+    return prepared;
+}
+
+std::array<int, 5> compare(const Prepared& prepared1, const Prepared& prepared2) {
     // TODO: Write your code here
     std::array<int, 5> result = {0, 0, 0, 0, 0};
     std::vector<int> approx_reply;
+    const std::vector<int>& submission1 = prepared1.tokens;
+    const std::vector<int>& submission2 = prepared2.tokens;
     int n1 = submission1.size();
     int n2 = submission2.size();
 
     if(n1>n2) {
-        result[1]=Exact_Match::exact_match(submission1,submission2);
+        result[1]=Exact_Match::exact_match(submission1,prepared1.text_hash,submission2,prepared2.pattern_hash);
         approx_reply = Approx_Match::findLCS(submission1,submission2);
         result[2] = approx_reply[2];
         result[3] = approx_reply[0];
@@ -260,7 +258,7 @@ std::array<int, 5> match_submissions(std::vector<int> &submission1, std::vector<
         
     } 
     else {
-        result[1]=Exact_Match::exact_match(submission2,submission1);
+        result[1]=Exact_Match::exact_match(submission2,prepared2.text_hash,submission1,prepared1.pattern_hash);
         approx_reply = Approx_Match::findLCS(submission2,submission1);
         result[2] = approx_reply[2];
         result[3] = approx_reply[1];
@@ -272,14 +270,14 @@ std::array<int, 5> match_submissions(std::vector<int> &submission1, std::vector<
     // End TODO
 }
 
+std::array<int, 5> match_submissions(std::vector<int> &submission1, std::vector<int> &submission2) {
+    return compare(*prepare(submission1), *prepare(submission2));
+}
 
+} // namespace checker_four
 
-
-
-
-
-
-
-
-
-
+#ifndef CHECKER_REGISTRY
+std::array<int, 5> match_submissions(std::vector<int> &submission1, std::vector<int> &submission2) {
+    return checker_four::match_submissions(submission1, submission2);
+}
+#endif
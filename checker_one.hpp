@@ -5,13 +5,20 @@
 #include <cmath>
 // -----------------------------------------------------------------------------
 
-#include <unordered_set>
 #include <algorithm>
+#include <memory>
+#include <optional>
+#include "cascade.hpp"
+
+namespace checker_one {
 
 // Constants defining match criteria
-#define MIN_PERFECT_MATCH 10
-#define MIN_APPROX_MATCH 30
-#define MATCH_THRESHOLD 0.8
+constexpr int MIN_PERFECT_MATCH = 10;
+constexpr int MIN_APPROX_MATCH = 30;
+constexpr double MATCH_THRESHOLD = 0.8;
+// Length of the exact seeds of the fuzzy match search: runs never reset within their first SEED_LENGTH cells,
+// see findLongestFuzzyMatch
+constexpr int SEED_LENGTH = 5;
 
 
 // RollingHash class to compute rolling hash values for a sequence
@@ -65,30 +72,66 @@ int checkMatchLength(const std::vector<int>& vec1, int start1,
 }
 
 
-// Finds exact matches between two sequences and returns the total matched length
-int findExactMatches(const std::vector<int>& submission1, const std::vector<int>& submission2,
-                     const int min_length = MIN_PERFECT_MATCH) {
-    RollingHash rolling_hash1(submission1), rolling_hash2(submission2);
-    std::vector<long long> hashes1 = rolling_hash1.generateHashes(min_length);
-    std::vector<long long> hashes2 = rolling_hash2.generateHashes(min_length);
+// Hashes of all windows of one length of a sequence, by start and grouped by hash
+class WindowIndex {
+public:
+    WindowIndex(const std::vector<int>& tokens, const int length) : length(length) {
+        // generateHashes needs at least length tokens
+        if (tokens.size() >= static_cast<std::size_t>(length)) hashes = RollingHash(tokens).generateHashes(length);
+        int windows = hashes.size();
+        for (int i = 0; i < windows; i++) sorted.push_back({hashes[i], i});
+        std::sort(sorted.begin(), sorted.end());
+    }
 
+    // Range of sorted holding the windows with the given hash
+    std::pair<int, int> group(long long hash) const {
+        auto first = std::lower_bound(sorted.begin(), sorted.end(), std::make_pair(hash, -1));
+        auto last = std::lower_bound(first, sorted.end(), std::make_pair(hash + 1, -1));
+        return {static_cast<int>(first - sorted.begin()), static_cast<int>(last - sorted.begin())};
+    }
+
+    int length;
+    // Hash of the window starting at each position
+    std::vector<long long> hashes;
+    // (hash, start) of every window, sorted
+    std::vector<std::pair<long long, int>> sorted;
+};
+
+// Finds exact matches between two sequences, given the indices of their min_length windows,
+// and returns the total matched length
+//
+// Left to right in submission1, each window is matched with the leftmost window of submission2 that has the
+// same hash, does not start inside an earlier match and really extends to min_length tokens or more; the match
+// is then extended as far as it goes. This is a hash join of the two window lists.
+int findExactMatches(const std::vector<int>& submission1, const std::vector<int>& submission2,
+                     const WindowIndex& windows1, const WindowIndex& windows2) {
+    const int min_length = windows1.length;
     int total_matched_length = 0;
-    std::unordered_set<int> matched_indices1, matched_indices2;
-
-    for (int i = 0; i < hashes1.size(); i++) {
-        for (int j = 0; j < hashes2.size(); j++) {
-            if (hashes1[i] == hashes2[j] && matched_indices1.count(i) == 0 &&
-                matched_indices2.count(j) == 0) {
-                int match_length = checkMatchLength(submission1, i, submission2, j);
-                if (match_length >= min_length) {
-                    for (int k = 0; k < match_length; k++) {
-                        matched_indices1.insert(i + k);
-                        matched_indices2.insert(j + k);
-                    }
-                    i += match_length - 1;
-                    total_matched_length += match_length;
-                    break;
-                }
+    std::vector<bool> matched2(submission2.size(), false);
+    // Per entry of windows2.sorted that starts a hash group, the first entry of the group not yet matched
+    std::vector<int> first_unmatched(windows2.sorted.size());
+    int entries2 = first_unmatched.size();
+    for (int k = 0; k < entries2; k++) first_unmatched[k] = k;
+
+    int entries1 = windows1.hashes.size();
+    for (int i = 0; i < entries1; i++) {
+        auto [first, last] = windows2.group(windows1.hashes[i]);
+        if (first == last) continue;
+        // Matched starts stay matched, so the cursor only moves forward
+        int& cursor = first_unmatched[first];
+        for (int k = cursor; k < last; k++) {
+            int j = windows2.sorted[k].second;
+            if (matched2[j]) {
+                if (k == cursor) cursor++;
+                continue;
+            }
+            int match_length = checkMatchLength(submission1, i, submission2, j);
+            if (match_length >= min_length) {
+                for (int m = 0; m < match_length; m++) matched2[j + m] = true;
+                if (k == cursor) cursor++;
+                i += match_length - 1;
+                total_matched_length += match_length;
+                break;
             }
         }
     }
@@ -96,56 +139,71 @@ int findExactMatches(const std::vector<int>& submission1, const std::vector<int>
     return total_matched_length;
 }
 
+// Finds exact matches between two sequences and returns the total matched length
+int findExactMatches(const std::vector<int>& submission1, const std::vector<int>& submission2,
+                     const int min_length = MIN_PERFECT_MATCH) {
+    return findExactMatches(submission1, submission2, WindowIndex(submission1, min_length),
+                            WindowIndex(submission2, min_length));
+}
 
 
-// Counts mismatches within a specified length from given starting indices in two sequences
-int countMismatches(const std::vector<int>& vec1, const std::vector<int>& vec2,
-                    int start1, int start2, int length) {
+
+// Follows the fuzzy match run that starts at (start1, start2) along its diagonal: a matching pair
+// extends it, and a mismatching one extends it only while at most 20% of the run mismatches.
+// Returns the length of the run, which ends just before the reset (or at the end of a sequence).
+int extendFuzzyRun(const std::vector<int>& vec1, const std::vector<int>& vec2, int start1, int start2) {
+    int size1 = vec1.size(), size2 = vec2.size();
+    int length = 0;
     int mismatches = 0;
-    for (int k = 0; k < length; k++) {
-        if (vec1[start1 - k] != vec2[start2 - k]) {
+    while (start1 + length < size1 && start2 + length < size2) {
+        if (vec1[start1 + length] != vec2[start2 + length]) {
+            int max_mismatches = static_cast<int>((length + 1) * (1 - MATCH_THRESHOLD));
+            if (mismatches + 1 > max_mismatches) break;
             mismatches++;
         }
+        length++;
     }
-    return mismatches;
+    return length;
 }
 
-
-// Finds the longest fuzzy match allowing limited mismatches within 80% and returns the starting indices as well
-std::array<int, 3> findLongestFuzzyMatch(const std::vector<int>& vec1, 
-                                         const std::vector<int>& vec2) {
+// Finds the longest fuzzy match allowing limited mismatches within 80% and returns the starting indices as well.
+//
+// The match is defined by a table over all pairs (i, j): a run along a diagonal grows by one cell per pair and
+// is reset to 0 at a mismatch that would leave more than 20% of the run mismatched. The result is the largest
+// cell, the first one in row-major order on ties, if it reaches MIN_APPROX_MATCH.
+//
+// Up to SEED_LENGTH cells no mismatch is allowed at all, so every run that matters opens with an exact seed,
+// and a seed is never inside a run that dies before it. Runs are therefore followed from the seeds only,
+// skipping seeds that fall inside a run already followed on their diagonal.
+std::array<int, 3> findLongestFuzzyMatch(const std::vector<int>& vec1, const std::vector<int>& vec2,
+                                         const WindowIndex& seeds1, const WindowIndex& seeds2) {
     int n = vec1.size();
     int m = vec2.size();
-    // Creating a 2D DP array
-    std::vector<std::vector<int>> dp(n + 1, std::vector<int>(m + 1, 0));
     int max_length = 0;
     int start_index1 = -1;
     int start_index2 = -1;
+    // Per diagonal j - i + n, the first start in vec1 not covered by a run followed so far
+    std::vector<int> next_start(n + m + 1, 0);
 
-    // Iterate through each position in both vectors
-    for (int i = 1; i <= n; i++) {
-        for (int j = 1; j <= m; j++) {
-            if (vec1[i - 1] == vec2[j - 1]) {
-                // If elements match, extend the match length from the previous position
-                dp[i][j] = dp[i - 1][j - 1] + 1;
-            } else {
-                // If elements do not match, consider a "fuzzy" match with mismatches
-                int length = dp[i - 1][j - 1] + 1;
-                int max_mismatches = static_cast<int>(length * (1 - MATCH_THRESHOLD));
-                int mismatches = countMismatches(vec1, vec2, i - 1, j - 1, length);
-
-                if (mismatches <= max_mismatches) {
-                    dp[i][j] = length;
-                } else {
-                    dp[i][j] = 0;
-                }
-            }
+    int windows1 = seeds1.hashes.size();
+    for (int i = 0; i < windows1; i++) {
+        auto [first, last] = seeds2.group(seeds1.hashes[i]);
+        for (int k = first; k < last; k++) {
+            int j = seeds2.sorted[k].second;
+            int diagonal = j - i + n;
+            if (i < next_start[diagonal]) continue;
+            if (!std::equal(vec1.begin() + i, vec1.begin() + i + SEED_LENGTH, vec2.begin() + j)) continue;
 
-            // Update longest match details if the current match length is the largest found
-            if (dp[i][j] > max_length) {
-                max_length = dp[i][j];
-                start_index1 = i - max_length;
-                start_index2 = j - max_length;
+            int length = extendFuzzyRun(vec1, vec2, i, j);
+            next_start[diagonal] = i + length + 1;
+            // The run's largest cell is its last one, in row i + length; on equal lengths keep the earliest row,
+            // then the earliest column
+            int row = i + length, best_row = start_index1 + max_length;
+            if (length > max_length ||
+                (length == max_length && (row < best_row || (row == best_row && j < start_index2)))) {
+                max_length = length;
+                start_index1 = i;
+                start_index2 = j;
             }
         }
     }
@@ -158,13 +216,65 @@ std::array<int, 3> findLongestFuzzyMatch(const std::vector<int>& vec1,
     return {max_length, start_index1, start_index2};
 }
 
-std::array<int, 5> match_submissions(std::vector<int>& submission1, std::vector<int>& submission2) {
-    auto [fuzzy_match_length, start_index1, start_index2] = findLongestFuzzyMatch(submission1, submission2);
+// Finds the longest fuzzy match allowing limited mismatches within 80% and returns the starting indices as well
+std::array<int, 3> findLongestFuzzyMatch(const std::vector<int>& vec1,
+                                         const std::vector<int>& vec2) {
+    return findLongestFuzzyMatch(vec1, vec2, WindowIndex(vec1, SEED_LENGTH), WindowIndex(vec2, SEED_LENGTH));
+}
+
+// Verdict from the total exact match length and the longest fuzzy match
+bool isPlagiarized(int total_match_length, int fuzzy_match_length, size_t min_size) {
+    return (total_match_length >= (0.15 * min_size) && fuzzy_match_length >= (0.3 * min_size)) || 
+           total_match_length >= 300 || fuzzy_match_length >= 250;
+}
+
+// Per-submission part of a comparison, built once by prepare() and shared by every
+// compare() the submission takes part in
+struct Prepared {
+    std::vector<int> tokens;
+    WindowIndex windows; // MIN_PERFECT_MATCH windows, for the exact matches
+    WindowIndex seeds; // SEED_LENGTH windows, for the fuzzy match
+};
+
+std::shared_ptr<const Prepared> prepare(const std::vector<int>& submission) {
+    return std::make_shared<const Prepared>(Prepared{submission, WindowIndex(submission, MIN_PERFECT_MATCH),
+                                                     WindowIndex(submission, SEED_LENGTH)});
+}
+
+std::array<int, 5> compare(const Prepared& prepared1, const Prepared& prepared2) {
+    const std::vector<int>& submission1 = prepared1.tokens;
+    const std::vector<int>& submission2 = prepared2.tokens;
+    auto [fuzzy_match_length, start_index1, start_index2] = findLongestFuzzyMatch(submission1, submission2, prepared1.seeds, prepared2.seeds);
     size_t min_size = std::min(submission1.size(), submission2.size());
-    int total_match_length = findExactMatches(submission1, submission2);
+    int total_match_length = findExactMatches(submission1, submission2, prepared1.windows, prepared2.windows);
 
-    bool is_plagiarized = (total_match_length >= (0.15 * min_size) && fuzzy_match_length >= (0.3 * min_size)) || 
-                         total_match_length >= 300 || fuzzy_match_length >= 250;
+    return {isPlagiarized(total_match_length, fuzzy_match_length, min_size) ? 1 : 0, total_match_length,
+            fuzzy_match_length, start_index1, start_index2};
+}
+
+// Exact matches need a common window of MIN_PERFECT_MATCH tokens, and a fuzzy run of MIN_APPROX_MATCH cells
+// has at least MATCH_THRESHOLD of them matching, each a token the two submissions have in common. Without
+// either, both lengths are 0.
+std::optional<std::array<int, 5>> settle(const cascade::facts_t& facts) {
+    static_assert(MIN_PERFECT_MATCH == cascade::WINDOW);
+    if (facts.shares_window || facts.common_tokens >= MIN_APPROX_MATCH * MATCH_THRESHOLD) {
+        return std::nullopt;
+    }
+    size_t min_size = std::min(facts.size1, facts.size2);
+    return std::array<int, 5>{isPlagiarized(0, 0, min_size) ? 1 : 0, 0, 0, -1, -1};
+}
 
-    return {is_plagiarized ? 1 : 0, total_match_length, fuzzy_match_length, start_index1, start_index2};
-}
\ No newline at end of file
+std::array<int, 5> match_submissions(std::vector<int>& submission1, std::vector<int>& submission2) {
+    if (std::optional<std::array<int, 5>> settled = cascade::try_settle(submission1, submission2, &settle)) {
+        return *settled;
+    }
+    return compare(*prepare(submission1), *prepare(submission2));
+}
+
+} // namespace checker_one
+
+#ifndef CHECKER_REGISTRY
+std::array<int, 5> match_submissions(std::vector<int>& submission1, std::vector<int>& submission2) {
+    return checker_one::match_submissions(submission1, submission2);
+}
+#endif
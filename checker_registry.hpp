@@ -0,0 +1,127 @@
+#pragma once
+
+// Registry of every match_submissions variant in this directory.
+//
+// Each checker header keeps its code in its own namespace and, unless
+// CHECKER_REGISTRY is defined, also defines the unqualified
+// match_submissions the course driver calls. Defining CHECKER_REGISTRY drops
+// those forwarders so all checkers can live in one binary. The checker
+// headers define their functions out of line, so include this header in a
+// single translation unit.
+#define CHECKER_REGISTRY
+#include "checker_zero.hpp"
+#include "checker_one.hpp"
+#include "checker_two.hpp"
+#include "checker_three.hpp"
+#include "checker_four.hpp"
+#include "checker_five.hpp"
+#include "match_submissions.hpp"
+// -----------------------------------------------------------------------------
+#include "cascade.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+
+using match_function_t = std::array<int, 5> (*)(std::vector<int>&, std::vector<int>&);
+
+// Type-erased two-phase form of a checker. prepare builds the immutable
+// per-submission index once; compare takes two indices from the same
+// checker's prepare and gives the result match_submissions would.
+using prepared_index_t = std::shared_ptr<const void>;
+using prepare_function_t = prepared_index_t (*)(const std::vector<int>&);
+using compare_function_t = std::array<int, 5> (*)(const void*, const void*);
+
+struct checker_entry_t {
+    std::string_view name; // Short name used on command lines and in reports.
+    // Revision of the checker's results. Bump it with any change that can
+    // alter a result (thresholds, window lengths, tie-breaking), so results
+    // cached under result_cache_id are not reused.
+    std::string_view revision;
+    match_function_t match; // The checker's match_submissions.
+    prepare_function_t prepare;
+    compare_function_t compare;
+    // Decides pairs from the cheap facts of the cascade when it can; null for
+    // checkers that always need the full comparison.
+    cascade::settle_function_t settle;
+    // True if the result for (b, a) is always the result for (a, b) with
+    // result[3] and result[4] swapped, so result_cache may answer one from the
+    // other. None of the current checkers is: the order of the submissions
+    // breaks their ties and picks between equally long matches.
+    bool symmetric = false;
+};
+
+namespace checker_registry_detail {
+
+// Adapters from a checker's own prepare(submission) -> shared_ptr<const Index>
+// and compare(const Index&, const Index&).
+template <auto Prepare>
+prepared_index_t prepare_erased(const std::vector<int>& submission) {
+    return Prepare(submission);
+}
+
+template <typename Index, auto Compare>
+std::array<int, 5> compare_erased(const void* first, const void* second) {
+    return Compare(*static_cast<const Index*>(first), *static_cast<const Index*>(second));
+}
+
+// For checkers with nothing to precompute: the index is the token vector, and
+// compare runs match_submissions on copies of it.
+inline prepared_index_t prepare_tokens(const std::vector<int>& submission) {
+    return std::make_shared<const std::vector<int>>(submission);
+}
+
+template <match_function_t Match>
+std::array<int, 5> compare_tokens(const void* first, const void* second) {
+    std::vector<int> a = *static_cast<const std::vector<int>*>(first);
+    std::vector<int> b = *static_cast<const std::vector<int>*>(second);
+    return Match(a, b);
+}
+
+template <match_function_t Match>
+constexpr checker_entry_t unprepared(std::string_view name, std::string_view revision,
+                                     cascade::settle_function_t settle = nullptr) {
+    return {name, revision, Match, &prepare_tokens, &compare_tokens<Match>, settle};
+}
+
+template <match_function_t Match, auto Prepare, typename Index, auto Compare>
+constexpr checker_entry_t prepared(std::string_view name, std::string_view revision,
+                                   cascade::settle_function_t settle = nullptr) {
+    return {name, revision, Match, &prepare_erased<Prepare>, &compare_erased<Index, Compare>, settle};
+}
+
+} // namespace checker_registry_detail
+
+// All registered checkers, in a fixed order.
+inline const std::vector<checker_entry_t>& checker_registry(void) {
+    using namespace checker_registry_detail;
+    static const std::vector<checker_entry_t> registry = {
+        unprepared<&checker_zero::match_submissions>("zero", "1", &checker_zero::settle),
+        prepared<&checker_one::match_submissions, &checker_one::prepare,
+                 checker_one::Prepared, &checker_one::compare>("one", "1", &checker_one::settle),
+        unprepared<&checker_two::match_submissions>("two", "1"),
+        unprepared<&checker_three::match_submissions>("three", "1", &checker_three::settle),
+        prepared<&checker_four::match_submissions, &checker_four::prepare,
+                 checker_four::Prepared, &checker_four::compare>("four", "1"),
+        prepared<&checker_five::match_submissions, &checker_five::prepare,
+                 checker_five::Prepared, &checker_five::compare>("five", "1", &checker_five::settle),
+        prepared<&checker_sample::match_submissions, &checker_sample::prepare,
+                 checker_sample::Prepared, &checker_sample::compare>("sample", "1", &checker_sample::settle),
+    };
+    return registry;
+}
+
+// Returns the checker with the given name, or nullptr if there is none.
+inline const checker_entry_t* find_checker(std::string_view name) {
+    for (const checker_entry_t& entry : checker_registry()) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// The checker id under which result_cache keeps a checker's results: its
+// name and revision, e.g. "three@1".
+inline std::string result_cache_id(const checker_entry_t& entry) {
+    return std::string(entry.name) + '@' + std::string(entry.revision);
+}
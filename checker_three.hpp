@@ -4,14 +4,20 @@
 #include <vector>
 #include <cmath>
 // -----------------------------------------------------------------------------
-#include <set>
-#include <unordered_map>
-#include <string>
+#include <cstdint>
 #include<algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "bit_parallel_lcs.hpp"
+#include "cascade.hpp"
 // You are free to add any STL includes above this comment, below the --line--.
 // DO NOT add "using namespace std;" or include any other files/libraries.
 // Also DO NOT add the include "bits/stdc++.h"
 
+namespace checker_three {
+
 // OPTIONAL: Add your helper functions and data structures here
 
 
@@ -64,119 +70,105 @@ public:
 
 private:
     // Function to compute the LCS as pairs of indices (index from v1 and v2 for each matching element)
+    // The bit-parallel kernel keeps one bit per table cell, and only every sqrt(m)-th row of the table,
+    // and returns the same pairs as the backtrack over the full DP table.
     static std::vector<std::pair<int, int>> getLCS(const std::vector<int>& a, const std::vector<int>& b) {
-        int m = a.size(), n = b.size();
-        std::vector<std::vector<int>> dp(m + 1, std::vector<int>(n + 1, 0));  // DP table for LCS length calculation
-
-        // Fill the DP table based on matching elements between a and b
-        for (int i = 1; i <= m; ++i) {
-            for (int j = 1; j <= n; ++j) {
-                if (a[i-1] == b[j-1]) {
-                    dp[i][j] = dp[i-1][j-1] + 1;  // Extend LCS if elements match
-                } else {
-                    dp[i][j] = std::max(dp[i-1][j], dp[i][j-1]);  // Otherwise, take the longer of previous results
-                }
-            }
-        }
-
-        // Backtrack through the DP table to reconstruct the LCS as index pairs
-        std::vector<std::pair<int, int>> lcs;
-        int i = m, j = n;
-        while (i > 0 && j > 0) {
-            if (a[i-1] == b[j-1]) {
-                lcs.push_back({i-1, j-1});  // Add matching indices to the LCS list
-                --i; --j;  // Move diagonally in the DP table
-            } else if (dp[i-1][j] > dp[i][j-1]) {
-                --i;  // Move up in DP table if upper cell has greater LCS value
-            } else {
-                --j;  // Move left in DP table if left cell has greater LCS value
-            }
-        }
-        
-        std::reverse(lcs.begin(), lcs.end());  // Reverse to get indices in the correct order
-        return lcs;
+        return bit_parallel_lcs::alignment(a, b);
     }
 };
 
 
 
 
-//Function to find total length of matching substrings. FOR result[1]
-std::unordered_map<std::string, std::vector<int>> get_n_length_substrings(const std::vector<int>& tokens, int n, std::set<int>& used_indices) {
-    std::unordered_map<std::string, std::vector<int>> substrings;
-    for (size_t i = 0; i + n <= tokens.size(); ++i) {
-        // Check if this substring overlaps with already used indices
-        bool overlap = false;
-        for (int j = 0; j < n; ++j) {
-            if (used_indices.count(i + j)) {
-                overlap = true;
-                break;
-            }
-        }
-        if (overlap) continue;
+// Helpers for the total length of matching substrings. FOR result[1]
+// Positions already covered by a counted match, one bit each.
+class UsedPositions {
+public:
+    explicit UsedPositions(std::size_t size) : words(size / 64 + 2, 0) {}
+
+    // True if none of the length (at most 64) positions from start is used.
+    bool isFree(int start, int length) const {
+        int shift = start % 64;
+        std::uint64_t bits = words[start / 64] >> shift;
+        if (shift != 0) bits |= words[start / 64 + 1] << (64 - shift);
+        std::uint64_t mask = length == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << length) - 1;
+        return (bits & mask) == 0;
+    }
+
+    void mark(int start, int length) {
+        for (int j = start; j < start + length; ++j) words[j / 64] |= std::uint64_t(1) << (j % 64);
+    }
+
+private:
+    std::vector<std::uint64_t> words;
+};
 
-        // Build a string representation of the n-length substring
-        std::string pattern;
-        for (int j = 0; j < n; ++j) {
-            pattern += std::to_string(tokens[i + j]) + ",";
+// The tokens written out as "t0,t1,...,", with the offset of every token, so the pattern of
+// n tokens from i is the substring [offsets[i], offsets[i + n]).
+// The string keys are deliberate: result[1] depends on the order overlapping matches are taken in,
+// which is the iteration order of the original string-keyed maps. Integer rolling hashes, or any
+// other key or map, would visit the patterns in another order and change result[1].
+class PatternText {
+public:
+    explicit PatternText(const std::vector<int>& tokens) : offsets(tokens.size() + 1, 0) {
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            text += std::to_string(tokens[i]);
+            text += ',';
+            offsets[i + 1] = text.size();
         }
+    }
+
+    std::string_view of(int start, int n) const {
+        return std::string_view(text).substr(offsets[start], offsets[start + n] - offsets[start]);
+    }
+
+private:
+    std::string text;
+    std::vector<size_t> offsets;
+};
+
+// Starts of the free n-length windows, per pattern. The patterns are views of the same strings the
+// original keyed its std::unordered_map<std::string, ...> with, and std::hash<std::string_view>
+// equals std::hash<std::string>, so inserting the same windows in the same order gives the same
+// buckets and the same iteration order.
+using Patterns = std::unordered_map<std::string_view, std::vector<int>>;
 
-        // Store the starting index for each unique pattern
-        substrings[pattern].push_back(i);
+Patterns get_n_length_substrings(const PatternText& text, int size, int n, const UsedPositions& used) {
+    Patterns substrings;
+    for (int i = 0; i + n <= size; ++i) {
+        if (used.isFree(i, n)) substrings[text.of(i, n)].push_back(i);
     }
     return substrings;
 }
 
-// Function to find the total length of non-overlapping exact pattern matches between lengths 10 and max_match_len
+// Function to find the total length of non-overlapping exact pattern matches between lengths 10 and max_match_len.
+// Lengths are taken longest first. For each length, the patterns of submission1 are visited in the
+// iteration order of their hash map, and every free occurrence is paired with the first free occurrence of
+// the pattern in submission2; the order decides which overlapping matches are counted.
 int find_total_match_length(const std::vector<int>& submission1, const std::vector<int>& submission2, int min_match_len= 10, int max_match_len = 29) {
     int total_length = 0;
-    std::set<int> used_indices1, used_indices2; // Track used indices in each vector
+    int size1 = submission1.size(), size2 = submission2.size();
+    UsedPositions used1(size1), used2(size2); // Track used indices in each vector
+    PatternText text1(submission1), text2(submission2);
 
-    // Loop through each length from max_match_len to min_match_len
     for (int n = max_match_len; n >= min_match_len; --n) {
-        // Get all non-overlapping n-length substrings for both submissions
-        std::unordered_map<std::string, std::vector<int>> patterns1 = get_n_length_substrings(submission1, n, used_indices1);
-        std::unordered_map<std::string, std::vector<int>> patterns2 = get_n_length_substrings(submission2, n, used_indices2);
-
-        // Find common patterns and accumulate their lengths
-        for (const auto& entry : patterns1) {
-            const std::string& pattern = entry.first;
-
-            // Check if the pattern exists in both submissions
-            if (patterns2.find(pattern) != patterns2.end()) {
-                // Process each occurrence of the pattern in submission1
-                for (int idx1 : patterns1[pattern]) {
-                    // If indices overlap in submission1, skip this match
-                    bool overlap1 = false;
-                    for (int j = 0; j < n; ++j) {
-                        if (used_indices1.count(idx1 + j)) {
-                            overlap1 = true;
-                            break;
-                        }
-                    }
-                    if (overlap1) continue;
-
-                    // Process each occurrence of the pattern in submission2
-                    for (int idx2 : patterns2[pattern]) {
-                        bool overlap2 = false;
-                        for (int j = 0; j < n; ++j) {
-                            if (used_indices2.count(idx2 + j)) {
-                                overlap2 = true;
-                                break;
-                            }
-                        }
-                        if (overlap2) continue;
-
-                        // If no overlap, count this match and mark indices as used
-                        total_length += n;
-                        for (int j = 0; j < n; ++j) {
-                            used_indices1.insert(idx1 + j);
-                            used_indices2.insert(idx2 + j);
-                        }
-
-                        // Break after finding one match to avoid multiple counting for the same pattern
-                        break;
-                    }
+        // Fresh maps each round: the bucket count, and so the order, grows from empty as in the original.
+        Patterns patterns1 = get_n_length_substrings(text1, size1, n, used1);
+        Patterns patterns2 = get_n_length_substrings(text2, size2, n, used2);
+
+        for (const auto& [pattern, starts1] : patterns1) {
+            auto found = patterns2.find(pattern);
+            if (found == patterns2.end()) continue;
+            for (int idx1 : starts1) {
+                if (!used1.isFree(idx1, n)) continue;
+                for (int idx2 : found->second) {
+                    if (!used2.isFree(idx2, n)) continue;
+
+                    // If no overlap, count this match and mark indices as used
+                    total_length += n;
+                    used1.mark(idx1, n);
+                    used2.mark(idx2, n);
+                    break;
                 }
             }
         }
@@ -186,9 +178,20 @@ int find_total_match_length(const std::vector<int>& submission1, const std::vect
 }
 
 
+// Submissions without a single common token have no matches and an empty LCS, so the defaults stand.
+std::optional<std::array<int, 5>> settle(const cascade::facts_t& facts) {
+    if (facts.common_tokens > 0) {
+        return std::nullopt;
+    }
+    return std::array<int, 5>{0, 0, -1, -1, -1};
+}
+
 std::array<int, 5> match_submissions(std::vector<int> &submission1, 
         std::vector<int> &submission2) {
     // TODO: Write your code here
+    if (std::optional<std::array<int, 5>> settled = cascade::try_settle(submission1, submission2, &settle)) {
+        return *settled;
+    }
     std::array<int, 5> result = {-1, 0, -1, -1, -1};
     result[1] = find_total_match_length(submission1,submission2);
     Result longest = SequenceMatcher::findValidSequences(submission1, submission2);  //class RESULT IS DEFINED EARLIER 
@@ -213,4 +216,13 @@ std::array<int, 5> match_submissions(std::vector<int> &submission1,
     }
     return result; 
     // End TODO  
-}
\ No newline at end of file
+}
+
+} // namespace checker_three
+
+#ifndef CHECKER_REGISTRY
+std::array<int, 5> match_submissions(std::vector<int> &submission1, 
+        std::vector<int> &submission2) {
+    return checker_three::match_submissions(submission1, submission2);
+}
+#endif
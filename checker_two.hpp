@@ -15,8 +15,10 @@
 // Also DO NOT add the include "bits/stdc++.h"
 
 // OPTIONAL: Add your helper functions and data structures here
+namespace checker_two {
+
 //this is used to generate polynomial hashes.
-std::size_t polynomial_hash(const std::vector<int>& vec, int base = 31, int mod = 1e9 + 9) {
+std::size_t polynomial_hash(std::span<const int> vec, int base = 31, int mod = 1e9 + 9) {
     std::size_t hash_value = 0;
     std::size_t power = 1;
     for (const auto& num : vec) {
@@ -25,20 +27,112 @@ std::size_t polynomial_hash(const std::vector<int>& vec, int base = 31, int mod
     }
     return hash_value;
 }
+
+//polynomial_hash of every window of length k, in order of the window start, without copying the windows.
+//with reversed the tokens are read from the back, as if the vector had been reversed first.
+//for non-negative tokens the hash of the next window follows from the previous one in O(1):
+//drop the first token, divide by the base (multiply by its inverse), and add the new token times base^(k-1).
+//negative tokens wrap around in polynomial_hash's unsigned arithmetic, so then every window is hashed directly.
+std::vector<std::size_t> window_hashes(std::span<const int> tokens, int k, bool reversed = false) {
+    const std::size_t base = 31, mod = 1e9 + 9;
+    int n = tokens.size();
+    std::vector<std::size_t> hashes;
+    if (n < k) return hashes;
+    hashes.resize(n - k + 1);
+    auto token = [&](int i) { return tokens[reversed ? n - 1 - i : i]; };
+    bool non_negative = std::all_of(tokens.begin(), tokens.end(), [](int t) { return t >= 0; });
+    if (!non_negative) {
+        std::vector<int> window(k);
+        for (int i = 0; i + k <= n; i++) {
+            for (int j = 0; j < k; j++) window[j] = token(i + j);
+            hashes[i] = polynomial_hash(window);
+        }
+        return hashes;
+    }
+    std::size_t inverse_base = 1, top = 1;
+    for (std::size_t e = mod - 2, b = base; e > 0; e >>= 1, b = b * b % mod) {
+        if (e & 1) inverse_base = inverse_base * b % mod;
+    }
+    for (int j = 0; j + 1 < k; j++) top = top * base % mod;
+    std::size_t hash_value = 0, power = 1;
+    for (int j = 0; j < k; j++) {
+        hash_value = (hash_value + token(j) % mod * power) % mod;
+        power = power * base % mod;
+    }
+    hashes[0] = hash_value;
+    for (int i = 1; i + k <= n; i++) {
+        hash_value = (hash_value + mod - token(i - 1) % mod) % mod * inverse_base % mod;
+        hash_value = (hash_value + token(i + k - 1) % mod * top) % mod;
+        hashes[i] = hash_value;
+    }
+    return hashes;
+}
+
+//multiset intersection size of two runs of dense ids: the number of elements of the second
+//that find an unused equal element in the first. this is what winnowing computes, but with
+//one counter array kept across calls instead of a hash map per call.
+class WinnowingCounter {
+public:
+    explicit WinnowingCounter(int ids) : counts(ids, 0) {}
+
+    int matches(std::span<const int> ids1, std::span<const int> ids2) {
+        for (int id : ids1) counts[id]++;
+        int matched = 0;
+        for (int id : ids2) {
+            if (counts[id] > 0) {
+                counts[id]--;
+                matched++;
+            }
+        }
+        for (int id : ids1) counts[id] = 0;
+        return matched;
+    }
+
+private:
+    std::vector<int> counts;
+};
+
+//replaces every value by its rank among the distinct values of all the given vectors, so equal values get equal ids.
+std::vector<std::vector<int>> dense_ids(const std::vector<const std::vector<int>*>& vectors, int& id_count) {
+    std::vector<int> values;
+    for (const auto* vec : vectors) values.insert(values.end(), vec->begin(), vec->end());
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    id_count = values.size();
+    std::vector<std::vector<int>> ids;
+    for (const auto* vec : vectors) {
+        ids.emplace_back(vec->size());
+        for (std::size_t i = 0; i < vec->size(); i++) {
+            ids.back()[i] = std::lower_bound(values.begin(), values.end(), (*vec)[i]) - values.begin();
+        }
+    }
+    return ids;
+}
+
+//(hash, start) of every window, sorted, so the starts of one hash are an ascending run.
+std::vector<std::pair<std::size_t, int>> hash_index(const std::vector<std::size_t>& hashes) {
+    std::vector<std::pair<std::size_t, int>> index(hashes.size());
+    int windows = hashes.size();
+    for (int i = 0; i < windows; i++) index[i] = {hashes[i], i};
+    std::sort(index.begin(), index.end());
+    return index;
+}
+
+//range of hash_index entries with the given hash.
+std::pair<int, int> hash_range(const std::vector<std::pair<std::size_t, int>>& index, std::size_t hash) {
+    auto first = std::lower_bound(index.begin(), index.end(), std::make_pair(hash, 0));
+    auto last = std::upper_bound(first, index.end(), std::make_pair(hash, static_cast<int>(index.size())));
+    return {static_cast<int>(first - index.begin()), static_cast<int>(last - index.begin())};
+}
 //winnowing function is used to check if there is a significant match this function returns number of matched elements in first vector to second vector.
 //for smaller lengths i am taking k gram length 5 and doing directly inside the function total winnowing process.
 int winnowing_for_smaller_elements(const std::vector<int>& vector1, const std::vector<int>& vector2){
     int window_size=5;
-    std::vector<int>winnowingmap1;
-    std::vector<int>winnowingmap2;
-    for(int i=0;i+5<vector1.size();i++)
-{
-std::vector<int>subseq(vector1.begin()+i,vector1.begin()+i+5);
-winnowingmap1.push_back(polynomial_hash(subseq));
-}
-for(int i=0;i+5<vector2.size();i++){
-    std::vector<int>subseq(vector2.begin()+i,vector2.begin()+i+5);
-    winnowingmap2.push_back(polynomial_hash(subseq));}
+    //hashes of the 5 grams, leaving out the last one as before
+    std::vector<std::size_t> hashes1 = window_hashes(vector1, 5);
+    std::vector<std::size_t> hashes2 = window_hashes(vector2, 5);
+    std::vector<int>winnowingmap1(hashes1.begin(), hashes1.end() - (hashes1.empty() ? 0 : 1));
+    std::vector<int>winnowingmap2(hashes2.begin(), hashes2.end() - (hashes2.empty() ? 0 : 1));
 std::vector<int> minwinnowingmap1;
 std::vector<int> minwinnowingmap2;
 for (std::size_t i = 0; i + 5 <= winnowingmap1.size(); ++i) {
@@ -103,50 +197,41 @@ std::array<int, 5> match_submissions(std::vector<int> &submission1,
     std::array<int, 5> result = {0, 0, 0, 0, 0};
     std::vector<bool> visitedin1(submission1.size(), false);
     std::vector<bool> visitedin2(submission2.size(), false);
-    std::unordered_map<std::size_t, std::vector<int>> hash_map;
-    // Compute hashes for all subsequences of length 10 in submission1(contigious subseq)
-    for (std::size_t i = 0; i + 10 <= submission1.size(); ++i) {
-        std::vector<int> subsequence(submission1.begin() + i, submission1.begin() + i + 10);
-        std::size_t hash = polynomial_hash(subsequence);
-        hash_map[hash].push_back(i);
-    }
     int subseq_length = 10;
-    // here i am computing hashes for subsequences of length 10 in submission2(contigious subseq)
-    //and checking if there is a same hash in the submission1 hashes
+    //hashes of all subsequences of length 10 (contigious subseq) of both submissions, computed once by rolling them along.
+    //hash_index keeps them sorted with their starts, so the starts of one hash in submission1 are found by binary search.
+    std::vector<std::size_t> hashes1 = window_hashes(submission1, subseq_length);
+    std::vector<std::size_t> hashes2 = window_hashes(submission2, subseq_length);
+    std::vector<std::pair<std::size_t, int>> hash_map = hash_index(hashes1);
+    //here i am checking for every subsequence of length 10 in submission2 if there is a same hash in the submission1 hashes
     //if there is a subsequence match i am filling visitedin1 vector with true for matched 10 indices in both vectors visitedin1 and visitedin2.
     //i am using visitedin1 and visitedin2 because we should not do overcounting as mentioned in question.
     //here all the multiples of 10 subsequences will be captured and subsequences of lenth 13/14/15...will not be matched.for that i am doind in next part.
     for (int i = 0; i+subseq_length <= submission2.size(); ++i) {
-       if(!visitedin2[i]){ std::vector<int> subseq(submission2.begin() + i, submission2.begin() + i + subseq_length);
-        std::size_t hash_value = polynomial_hash(subseq);
-        
-        if (hash_map.find(hash_value) != hash_map.end()) {
-            for (int start_index : hash_map[hash_value]) {
+       if(!visitedin2[i]){
+        auto [first, last] = hash_range(hash_map, hashes2[i]);
+            for (int k = first; k < last; k++) {
+                int start_index = hash_map[k].second;
                 if (!visitedin1[start_index] &&!visitedin1[start_index+subseq_length-1]&& !visitedin2[i]&&!visitedin2[i+subseq_length-1]) {
                     for(int pp=0;pp<subseq_length;pp++){visitedin1[start_index+pp] = true;
                     visitedin2[i+pp] = true;}
                     // Increment the count of matched subsequences
                 }
             }
-        }
     }}
     
 //take a 15 length subseq we want to match all the 15 but from before step we only match first 10 and the next 5 will be left .
 //now the basic idea is to travese the submission1 and submission2 reversely and match.
 //them in reverse travesal visitedin1 and visitedin2 will be false for the wanted match so we can match it here.
-//so i reversed all submission1,submission2,visitedin1 and visitedin2.
-std::vector<int> reversed_submission1(submission1.rbegin(), submission1.rend());
-std::vector<int> reversed_submission2(submission2.rbegin(), submission2.rend());
-std::unordered_map<std::size_t, std::vector<int>> newhashmap;
-std::vector<bool> revvisitedin1(visitedin1.rbegin(), visitedin1.rend());
-std::vector<bool> revvisitedin2(visitedin2.rbegin(), visitedin2.rend());
+//position r of the reversed submission is position size-1-r of the submission, so instead of reversing
+//the submissions and visited vectors i read them through revvisitedin1/revvisitedin2 and hash the windows backwards.
+int size1 = submission1.size(), size2 = submission2.size();
+auto revvisitedin1 = [&](int r) { return visitedin1[size1 - 1 - r]; };
+auto revvisitedin2 = [&](int r) { return visitedin2[size2 - 1 - r]; };
 
 //i am computing hashes for the reverse subsequences.
-for (std::size_t i = 0; i + 10 <= reversed_submission1.size(); ++i) {
-    std::vector<int> subsequence(reversed_submission1.begin() + i, reversed_submission1.begin() + i + 10);
-    std::size_t hash = polynomial_hash(subsequence);
-    newhashmap[hash].push_back(i);
-}
+std::vector<std::size_t> revhashes2 = window_hashes(submission2, subseq_length, true);
+std::vector<std::pair<std::size_t, int>> newhashmap = hash_index(window_hashes(submission1, subseq_length, true));
 
 //now i am checking if a match is there.
 //here there is a different case take a subseq of length 10 A in subm1 
@@ -155,43 +240,41 @@ for (std::size_t i = 0; i + 10 <= reversed_submission1.size(); ++i) {
 //If we naively traverse like before we count this case which should not be counted.
 //so before making visited true. I am checking if this case is excluded by traversing forward and checking all the between hashes are matched.
 for (int i = 0; i+subseq_length<= submission2.size() ; ++i) {
-    if(!revvisitedin2[i]){
-    std::vector<int> subseq(reversed_submission2.begin() + i, reversed_submission2.begin() + i + subseq_length);
-    std::size_t hash_value = polynomial_hash(subseq);
-    if(newhashmap.find(hash_value)!=newhashmap.end()){
-        for(int start_index:newhashmap[hash_value]){
-            if(!revvisitedin1[start_index]&&!revvisitedin2[i]){
+    if(!revvisitedin2(i)){
+    auto [first, last] = hash_range(newhashmap, revhashes2[i]);
+        for(int k = first; k < last; k++){
+            int start_index = newhashmap[k].second;
+            if(!revvisitedin1(start_index)&&!revvisitedin2(i)){
                 int startindexin1=start_index;
                 int startindexin2=i;
-                while(startindexin1 < reversed_submission1.size() && startindexin2 < reversed_submission2.size() && startindexin1 + subseq_length - 1 < reversed_submission1.size() && startindexin2 + subseq_length - 1 < reversed_submission2.size()){
-                    std::vector<int> subseq1(reversed_submission2.begin() + startindexin2, reversed_submission2.begin() + startindexin2 + subseq_length);
-                    std::size_t hash_valuenow = polynomial_hash(subseq1);
-                     if(revvisitedin1[startindexin1]&&revvisitedin2[startindexin2]){
+                while(startindexin1 < size1 && startindexin2 < size2 && startindexin1 + subseq_length - 1 < size1 && startindexin2 + subseq_length - 1 < size2){
+                    std::size_t hash_valuenow = revhashes2[startindexin2];
+                     if(revvisitedin1(startindexin1)&&revvisitedin2(startindexin2)){
                         
-                        for(int j=start_index;j<=startindexin1;j++){revvisitedin1[j]=true;}
-                        for(int j=i;j<=startindexin2;j++){revvisitedin2[j]=true;}
+                        for(int j=start_index;j<=startindexin1;j++){visitedin1[size1 - 1 - j]=true;}
+                        for(int j=i;j<=startindexin2;j++){visitedin2[size2 - 1 - j]=true;}
                         //here found match should modify visited
                         ;break;
                      }
-                     if(revvisitedin1[startindexin1]&&!revvisitedin2[startindexin2]){break;}
-                     if(!revvisitedin1[startindexin1]&&revvisitedin2[startindexin2]){break;}
-                     if(newhashmap.find(hash_valuenow)!=newhashmap.end()){
-                            startindexin1+=1;
-                            startindexin2+=1;
-                     }
+                     if(revvisitedin1(startindexin1)&&!revvisitedin2(startindexin2)){break;}
+                     if(!revvisitedin1(startindexin1)&&revvisitedin2(startindexin2)){break;}
+                     //the window of submission2 here is in no window of submission1, nothing changes if we stay so stop.
+                     auto [found_first, found_last] = hash_range(newhashmap, hash_valuenow);
+                     if(found_first == found_last){break;}
+                     startindexin1+=1;
+                     startindexin2+=1;
 
                 }
             }
         }
     }
-    }
 }
 
 int count4=0;
 
 
-//finally i am counting total number of exact matches by counting total visited indexes in revvisitedin1.
-for (bool visited : revvisitedin1) {
+//finally i am counting total number of exact matches by counting total visited indexes in submission1.
+for (bool visited : visitedin1) {
     if (visited) {
         count4++;
     }
@@ -238,17 +321,9 @@ for (bool visited : revvisitedin1) {
 
 //winnowingmap1 one for calculating hashes of all k grams from submission1 and storing similarly winnowingmap2 for submission2. 
 //minwinnowingmap1 and minwinnowingmap2 are used to store the minimum hash values of the k grams in the window of 10.
-std::vector<int>winnowingmap1;
-std::vector<int>winnowingmap2;
-for(int i=0;i+10<submission1.size();i++)
-{
-std::vector<int>subseq(submission1.begin()+i,submission1.begin()+i+10);
-winnowingmap1.push_back(polynomial_hash(subseq));
-}
-for(int i=0;i+10<submission2.size();i++){
-    std::vector<int>subseq(submission2.begin()+i,submission2.begin()+i+10);
-    winnowingmap2.push_back(polynomial_hash(subseq));   
-}
+//the hashes of the k grams are the window hashes from the exact matching, leaving out the last window as before.
+std::vector<int>winnowingmap1(hashes1.begin(), hashes1.end() - (hashes1.empty() ? 0 : 1));
+std::vector<int>winnowingmap2(hashes2.begin(), hashes2.end() - (hashes2.empty() ? 0 : 1));
 std::vector<int> minwinnowingmap1;
 for (std::size_t i = 0; i + 10 <= winnowingmap1.size(); ++i) {
     int min_value = *std::min_element(winnowingmap1.begin() + i, winnowingmap1.begin() + i + 10);
@@ -262,6 +337,12 @@ for (std::size_t i = 0; i + 10 <= winnowingmap2.size(); ++i) {
 
 int final_longest_approxmatch_length=0;int final_start_index_in_submission1=0;int final_start_index_in_submission2=0;
 
+//the binary search compares many windows of the same four vectors, so their values are numbered densely once
+//and every comparison counts matches in one reused counter array on spans of the numbered vectors.
+int id_count = 0;
+std::vector<std::vector<int>> ids = dense_ids({&minwinnowingmap1, &minwinnowingmap2, &submission1, &submission2}, id_count);
+std::span<const int> minids1 = ids[0], minids2 = ids[1], tokenids1 = ids[2], tokenids2 = ids[3];
+WinnowingCounter counter(id_count);
 
 int first=30;
 int last=minwinnowingmap1.size();
@@ -271,48 +352,18 @@ while(first<last){
     
     bool found=false;
     int i=mid;
-    
-       if(i>1000){
-        for(int p=0;p+i<=minwinnowingmap1.size();p=p+50){
-        std::vector<int>subseq1(minwinnowingmap1.begin()+p,minwinnowingmap1.begin()+p+i);
-        for(int q=0;q+i<=minwinnowingmap2.size();q=q+50){
-            
-           std::vector<int>subseq2(minwinnowingmap2.begin()+q,minwinnowingmap2.begin()+q+i);
-            int numofmatches=winnowing(subseq1,subseq2);
-            double similarity=numofmatches*100.0/(subseq1.size()+subseq2.size()-numofmatches);
-            if(similarity>80){
-                
-                found=true;
-            final_longest_approxmatch_length=i;final_start_index_in_submission2=p;final_start_index_in_submission1=q;
-              break;
-            }
-        }if(found){break;}
-    }
-       }
-       else if(i>150){for(int p=0;p+i<=minwinnowingmap1.size();p=p+10){
-        std::vector<int>subseq1(minwinnowingmap1.begin()+p,minwinnowingmap1.begin()+p+i);
-        for(int q=0;q+i<=minwinnowingmap2.size();q=q+10){
-            
-           std::vector<int>subseq2(minwinnowingmap2.begin()+q,minwinnowingmap2.begin()+q+i);
-            int numofmatches=winnowing(subseq1,subseq2);
-            double similarity=numofmatches*100.0/(subseq1.size()+subseq2.size()-numofmatches);
-            if(similarity>85){
-                
-                found=true;
-            final_longest_approxmatch_length=i;final_start_index_in_submission2=p;final_start_index_in_submission1=q;
-              break;
-            }
-        }if(found){break;}
-    }}
-    else{
-        for(int p=0;p+i<=submission1.size();p=p+10){
-        std::vector<int>subseq1(submission1.begin()+p,submission1.begin()+p+i);
-        for(int q=0;q+i<=submission2.size();q=q+10){
+    //stride and similarity threshold for this length, and the vectors whose windows are compared.
+    int stride = i > 150 ? (i > 1000 ? 50 : 10) : 10;
+    int threshold = i > 150 ? (i > 1000 ? 80 : 85) : 92;
+    std::span<const int> ids1 = i > 150 ? minids1 : tokenids1;
+    std::span<const int> ids2 = i > 150 ? minids2 : tokenids2;
+    int size1 = ids1.size(), size2 = ids2.size();
+        for(int p=0;p+i<=size1;p=p+stride){
+        for(int q=0;q+i<=size2;q=q+stride){
             
-           std::vector<int>subseq2(submission2.begin()+q,submission2.begin()+q+i);
-            int numofmatches=winnowing(subseq1,subseq2);
-            double similarity=numofmatches*100.0/(subseq1.size()+subseq2.size()-numofmatches);
-            if(similarity>92){
+            int numofmatches=counter.matches(ids1.subspan(p, i), ids2.subspan(q, i));
+            double similarity=numofmatches*100.0/(i+i-numofmatches);
+            if(similarity>threshold){
                 
                 found=true;
             final_longest_approxmatch_length=i;final_start_index_in_submission2=p;final_start_index_in_submission1=q;
@@ -321,8 +372,6 @@ while(first<last){
         }if(found){break;}
     }
 
-    }
-
     if(found){
         first=mid+1;
     }
@@ -413,4 +462,13 @@ result[4]=final_start_index_in_submission1;
     
     return result; // dummy return
     // End TODO
-}
\ No newline at end of file
+}
+
+} // namespace checker_two
+
+#ifndef CHECKER_REGISTRY
+std::array<int, 5> match_submissions(std::vector<int> &submission1, 
+        std::vector<int> &submission2) {
+    return checker_two::match_submissions(submission1, submission2);
+}
+#endif
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary file of tokenized submissions, read through mmap.
+//
+// Layout, in the byte order of the machine that wrote it:
+//   header_t                      magic, version, token width, count
+//   std::uint64_t[count + 1]      offsets: submission i is tokens
+//                                 [offsets[i], offsets[i + 1])
+//   token data                    int32 or uint16 per token, contiguous
+// Every part starts at a multiple of 8 bytes. A file from a machine of the
+// other byte order fails the version check.
+//
+// A corpus_t maps the file read-only, so opening one costs a validation pass
+// over the offsets, and submissions are paged in as they are touched. With
+// 32-bit tokens, tokens(i) is a view into the mapping; 16-bit corpora are
+// half the size and are widened by copy().
+namespace corpus {
+
+enum class width_t : std::uint32_t { int32 = 4, uint16 = 2 };
+
+struct header_t {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t width; // Bytes per token, a width_t.
+    std::uint64_t count; // Number of submissions.
+};
+
+constexpr char MAGIC[8] = {'T', 'O', 'K', 'C', 'O', 'R', 'P', 'S'};
+constexpr std::uint32_t VERSION = 1;
+
+// Writes submissions to path, through a temporary file renamed over path.
+// Throws std::out_of_range if a token does not fit the width, and
+// std::system_error if the file cannot be written.
+inline void write(const std::string& path, const std::vector<std::vector<int>>& submissions,
+                  width_t width = width_t::int32) {
+    header_t header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = static_cast<std::uint32_t>(width);
+    header.count = submissions.size();
+    std::vector<std::uint64_t> offsets(submissions.size() + 1, 0);
+    for (std::size_t i = 0; i < submissions.size(); ++i) {
+        offsets[i + 1] = offsets[i] + submissions[i].size();
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+        std::vector<std::uint16_t> narrow;
+        for (const std::vector<int>& tokens : submissions) {
+            if (width == width_t::int32) {
+                out.write(reinterpret_cast<const char*>(tokens.data()), tokens.size() * sizeof(int));
+                continue;
+            }
+            narrow.assign(tokens.size(), 0);
+            for (std::size_t k = 0; k < tokens.size(); ++k) {
+                if (tokens[k] < 0 || tokens[k] > 0xffff) {
+                    std::remove(temporary.c_str());
+                    throw std::out_of_range("token does not fit in 16 bits");
+                }
+                narrow[k] = static_cast<std::uint16_t>(tokens[k]);
+            }
+            out.write(reinterpret_cast<const char*>(narrow.data()), narrow.size() * sizeof(std::uint16_t));
+        }
+        if (!out.flush()) {
+            throw std::system_error(errno, std::generic_category(), "corpus write");
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "corpus rename");
+    }
+}
+
+// A corpus file mapped into memory. Views handed out stay valid as long as
+// the corpus_t does.
+class corpus_t {
+public:
+    // Maps and validates the file. Throws std::system_error if it cannot be
+    // mapped and std::runtime_error if it is not a well-formed corpus.
+    explicit corpus_t(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "corpus open");
+        }
+        struct stat status{};
+        if (::fstat(fd, &status) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "corpus stat");
+        }
+        size_ = static_cast<std::size_t>(status.st_size);
+        if (size_ > 0) {
+            void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "corpus mmap");
+            }
+            data_ = static_cast<const unsigned char*>(mapping);
+        }
+        ::close(fd);
+        try {
+            validate();
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    ~corpus_t(void) { unmap(); }
+
+    corpus_t(corpus_t&& other) noexcept { *this = std::move(other); }
+
+    corpus_t& operator=(corpus_t&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            count_ = other.count_;
+            width_ = other.width_;
+            offsets_ = other.offsets_;
+            tokens_ = other.tokens_;
+        }
+        return *this;
+    }
+
+    corpus_t(const corpus_t&) = delete;
+    corpus_t& operator=(const corpus_t&) = delete;
+
+    std::size_t size(void) const { return count_; }
+    width_t width(void) const { return width_; }
+
+    // Number of tokens of submission i.
+    std::size_t length(std::size_t i) const { return offsets_[i + 1] - offsets_[i]; }
+
+    // Submission i, without copying. Only for 32-bit corpora; throws
+    // std::logic_error on a 16-bit one.
+    std::span<const int> tokens(std::size_t i) const {
+        if (width_ != width_t::int32) {
+            throw std::logic_error("corpus tokens are 16-bit; use copy()");
+        }
+        return {reinterpret_cast<const int*>(tokens_) + offsets_[i], length(i)};
+    }
+
+    // Views of every submission of a 32-bit corpus, for all_pairs.
+    std::vector<std::span<const int>> views(void) const {
+        std::vector<std::span<const int>> all;
+        all.reserve(count_);
+        for (std::size_t i = 0; i < count_; ++i) {
+            all.push_back(tokens(i));
+        }
+        return all;
+    }
+
+    // Submission i as ints, in any width, reusing out's storage.
+    void copy(std::size_t i, std::vector<int>& out) const {
+        if (width_ == width_t::int32) {
+            std::span<const int> view = tokens(i);
+            out.assign(view.begin(), view.end());
+            return;
+        }
+        const std::uint16_t* first = reinterpret_cast<const std::uint16_t*>(tokens_) + offsets_[i];
+        out.assign(first, first + length(i));
+    }
+
+private:
+    void validate(void) {
+        if (size_ < sizeof(header_t)) {
+            throw std::runtime_error("corpus file is truncated");
+        }
+        header_t header;
+        std::memcpy(&header, data_, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("not a corpus file");
+        }
+        if (header.version != VERSION) {
+            throw std::runtime_error("unsupported corpus version or byte order");
+        }
+        if (header.width != static_cast<std::uint32_t>(width_t::int32)
+                && header.width != static_cast<std::uint32_t>(width_t::uint16)) {
+            throw std::runtime_error("unsupported corpus token width");
+        }
+        std::size_t available = (size_ - sizeof(header_t)) / sizeof(std::uint64_t);
+        if (header.count >= available) {
+            throw std::runtime_error("corpus file is truncated");
+        }
+        count_ = header.count;
+        width_ = static_cast<width_t>(header.width);
+        offsets_ = reinterpret_cast<const std::uint64_t*>(data_ + sizeof(header_t));
+        tokens_ = reinterpret_cast<const unsigned char*>(offsets_ + count_ + 1);
+        if (offsets_[0] != 0) {
+            throw std::runtime_error("corpus offsets are corrupt");
+        }
+        for (std::size_t i = 0; i < count_; ++i) {
+            if (offsets_[i + 1] < offsets_[i]) {
+                throw std::runtime_error("corpus offsets are corrupt");
+            }
+        }
+        std::size_t data_size = size_ - (tokens_ - data_);
+        if (offsets_[count_] > data_size / header.width) {
+            throw std::runtime_error("corpus file is truncated");
+        }
+    }
+
+    void unmap(void) {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<unsigned char*>(data_), size_);
+            data_ = nullptr;
+        }
+    }
+
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t count_ = 0;
+    width_t width_ = width_t::int32;
+    const std::uint64_t* offsets_ = nullptr;
+    const unsigned char* tokens_ = nullptr;
+};
+
+// Runs a checker that takes its submissions as std::vector<int>& on two
+// views. The tokens are copied into per-thread buffers, which keep their
+// capacity, so a batch run allocates only while the buffers grow.
+template <typename Match>
+std::array<int, 5> match(Match match, std::span<const int> first, std::span<const int> second) {
+    thread_local std::vector<int> a, b;
+    a.assign(first.begin(), first.end());
+    b.assign(second.begin(), second.end());
+    return match(a, b);
+}
+
+} // namespace corpus
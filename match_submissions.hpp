@@ -4,65 +4,89 @@
 #include <span>
 #include <cmath>
 #include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include "cascade.hpp"
+
+namespace checker_sample {
+
+// Window lengths and thresholds of the checker. The window kernels take their length as a
+// template argument, so each length gets its own instantiation with a fixed trip count.
+struct Policy {
+    // Shortest exact match counted, and the length the greedy string tiling starts searching at
+    static constexpr size_t minimumMatchLength = 10;
+    static constexpr size_t initialSearchLength = 20;
+    static constexpr size_t longPatternWindow = 30;
+    static constexpr double similarityThreshold = 0.8;
+    // Shares of the smaller submission that make the matches significant
+    static constexpr double exactMatch = 0.2;
+    static constexpr double approximateMatch = 0.3;
+};
 
 // Calculate the similarity score between two segments
+template <size_t Length>
 double calculateSimilarity(const std::vector<int>& segment1,
                            const std::vector<int>& segment2,
                            size_t start1,
-                           size_t start2,
-                           size_t length) {
+                           size_t start2) {
     int matchCount = 0;
-    for (size_t i = 0; i < length; ++i) {
+    for (size_t i = 0; i < Length; ++i) {
         if (segment1[start1 + i] == segment2[start2 + i]) {
             matchCount++;
         }
     }
-    return static_cast<double>(matchCount) / length;
-}
-
-// Helper function for checking exact matches between segments
-bool isExactMatch(const std::vector<int>& data1, const std::vector<int>& data2,
-                  size_t start1, size_t start2, size_t length) {
-    for (size_t i = 0; i < length; ++i) {
-        if (data1[start1 + i] != data2[start2 + i]) return false;
-    }
-    return true;
+    return static_cast<double>(matchCount) / Length;
 }
 
 // Calculate hash for a segment using rolling hash technique
-size_t computeSegmentHash(const std::vector<int>& data, size_t start, size_t length) {
+template <size_t Length>
+size_t computeSegmentHash(const std::vector<int>& data, size_t start) {
     const size_t primeBase = 31;
     const size_t modulus = 1e9 + 9;
     size_t hashValue = 0;
     size_t primePower = 1;
 
-    for (size_t i = 0; i < length; ++i) {
+    for (size_t i = 0; i < Length; ++i) {
         hashValue = (hashValue + (data[start + i] * primePower) % modulus) % modulus;
         primePower = (primePower * primeBase) % modulus;
     }
     return hashValue;
 }
 
-// Sliding window optimization for searching long patterns
-void searchForLongPatterns(const std::vector<int>& submission1,
-                           const std::vector<int>& submission2,
-                           size_t windowSize, int& maxMatchLength,
-                           int& startIndex1, int& startIndex2) {
-    const size_t stepSize = windowSize / 4;
+// Hashes of the windows searchForLongPatterns steps through, by start
+template <size_t WindowSize>
+std::unordered_map<size_t, std::vector<size_t>> hashLongPatterns(const std::vector<int>& data) {
+    const size_t stepSize = WindowSize / 4;
     std::unordered_map<size_t, std::vector<size_t>> hashMap;
-    for (size_t i = 0; i + windowSize <= submission2.size(); i += stepSize) {
-        size_t hash = computeSegmentHash(submission2, i, windowSize);
+    for (size_t i = 0; i + WindowSize <= data.size(); i += stepSize) {
+        size_t hash = computeSegmentHash<WindowSize>(data, i);
         hashMap[hash].push_back(i);
     }
-    for (size_t i = 0; i + windowSize <= submission1.size(); i += stepSize) {
-        size_t hash = computeSegmentHash(submission1, i, windowSize);
-        if (hashMap.count(hash)) {
-            for (size_t pos : hashMap[hash]) {
-                double similarityScore = calculateSimilarity(
-                    submission1, submission2, i, pos, windowSize);
-                if (similarityScore >= 0.8) {
-                    if (windowSize > maxMatchLength) {
-                        maxMatchLength = windowSize;
+    return hashMap;
+}
+
+// Sliding window optimization for searching long patterns, given the window hashes
+// of submission2 from hashLongPatterns
+template <size_t WindowSize>
+void searchForLongPatterns(const std::vector<int>& submission1,
+                           const std::vector<int>& submission2,
+                           const std::unordered_map<size_t, std::vector<size_t>>& hashMap,
+                           int& maxMatchLength,
+                           int& startIndex1, int& startIndex2) {
+    const size_t stepSize = WindowSize / 4;
+    for (size_t i = 0; i + WindowSize <= submission1.size(); i += stepSize) {
+        size_t hash = computeSegmentHash<WindowSize>(submission1, i);
+        auto found = hashMap.find(hash);
+        if (found != hashMap.end()) {
+            for (size_t pos : found->second) {
+                double similarityScore = calculateSimilarity<WindowSize>(
+                    submission1, submission2, i, pos);
+                if (similarityScore >= Policy::similarityThreshold) {
+                    if (WindowSize > maxMatchLength) {
+                        maxMatchLength = WindowSize;
                         startIndex1 = i;
                         startIndex2 = pos;
                     }
@@ -72,52 +96,139 @@ void searchForLongPatterns(const std::vector<int>& submission1,
     }
 }
 
-// Exact match detection with rolling hash optimization
-void detectExactMatches(const std::vector<int>& submission1,
-                        const std::vector<int>& submission2,
-                        std::vector<bool>& usedInSubmission1,
-                        std::vector<bool>& usedInSubmission2,
-                        int& totalExactMatchLength) {
-    const size_t minLength = 10;
-    const size_t maxLength = 20;
-    for (size_t len = maxLength; len >= minLength; --len) {
-        std::vector<size_t> hashesForSubmission2(submission2.size() - len + 1);
-        for (size_t j = 0; j + len <= submission2.size(); ++j) {
-            hashesForSubmission2[j] = computeSegmentHash(submission2, j, len);
+// Polynomial hashes modulo 2^64 of the windows of a submission, from prefix hashes, so a window
+// of any length hashes in O(1). Equal hashes are only candidates; tiles are confirmed on the tokens.
+class WindowHashes {
+public:
+    explicit WindowHashes(const std::vector<int>& tokens) : prefix(tokens.size() + 1, 0), powers(tokens.size() + 1, 1) {
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            prefix[i + 1] = prefix[i] * base + static_cast<std::uint32_t>(tokens[i]);
+            powers[i + 1] = powers[i] * base;
+        }
+    }
+
+    std::uint64_t of(size_t start, size_t length) const {
+        return prefix[start + length] - prefix[start] * powers[length];
+    }
+
+private:
+    static constexpr std::uint64_t base = 0x100000001B3ull;
+    std::vector<std::uint64_t> prefix;
+    std::vector<std::uint64_t> powers;
+};
+
+// Starts of the windows of the given length that hold no used token
+std::vector<size_t> freeWindows(const std::vector<bool>& used, size_t length) {
+    std::vector<size_t> starts;
+    size_t run = 0; // Unused tokens ending at i
+    for (size_t i = 0; i < used.size(); ++i) {
+        run = used[i] ? 0 : run + 1;
+        if (run >= length) starts.push_back(i + 1 - length);
+    }
+    return starts;
+}
+
+// Running-Karp-Rabin Greedy String Tiling (Wise, 1993), given the window hashes of both submissions.
+// Tiles are common runs of at least Policy::minimumMatchLength tokens that overlap no other tile in either
+// submission, taken longest first; ties go to the earlier start in submission1, then in submission2.
+// Each round hashes the free windows of submission2 of the search length, looks up those of
+// submission1 and extends every hit as far as both sides stay equal and free. A match more than twice
+// the search length restarts the round at its length; otherwise the round's matches become tiles where
+// they are still free and the search length shrinks, down to Policy::minimumMatchLength, which is repeated
+// until no tile is added. Marks the tiles' tokens in the used vectors and returns their total length.
+int greedyStringTiling(const std::vector<int>& submission1,
+                       const std::vector<int>& submission2,
+                       const WindowHashes& hashes1,
+                       const WindowHashes& hashes2,
+                       std::vector<bool>& usedInSubmission1,
+                       std::vector<bool>& usedInSubmission2) {
+    struct Match {
+        size_t length, start1, start2;
+    };
+    std::vector<std::pair<std::uint64_t, size_t>> windows2;
+    std::vector<Match> matches;
+
+    // Collects the matches of at least length tokens; returns the length of the longest, or of the
+    // first one longer than twice length, at which the scan stops.
+    auto scan = [&](size_t length) {
+        matches.clear();
+        windows2.clear();
+        for (size_t start : freeWindows(usedInSubmission2, length)) {
+            windows2.push_back({hashes2.of(start, length), start});
         }
-        for (size_t i = 0; i + len <= submission1.size(); ++i) {
-            bool isUsed = false;
-            for (size_t k = i; k < i + len; ++k) {
-                if (usedInSubmission1[k]) {
-                    isUsed = true;
-                    break;
+        std::sort(windows2.begin(), windows2.end());
+        size_t longest = 0;
+        for (size_t i : freeWindows(usedInSubmission1, length)) {
+            std::uint64_t hash = hashes1.of(i, length);
+            auto candidate = std::lower_bound(windows2.begin(), windows2.end(), std::make_pair(hash, size_t(0)));
+            for (; candidate != windows2.end() && candidate->first == hash; ++candidate) {
+                size_t j = candidate->second;
+                if (!std::equal(submission1.begin() + i, submission1.begin() + i + length, submission2.begin() + j)) continue;
+                size_t k = length;
+                while (i + k < submission1.size() && j + k < submission2.size() &&
+                       submission1[i + k] == submission2[j + k] &&
+                       !usedInSubmission1[i + k] && !usedInSubmission2[j + k]) {
+                    ++k;
                 }
+                if (k > 2 * length) return k;
+                matches.push_back({k, i, j});
+                longest = std::max(longest, k);
             }
-            if (isUsed) continue;
-            size_t hash1 = computeSegmentHash(submission1, i, len);
-            for (size_t j = 0; j + len <= submission2.size(); ++j) {
-                if (usedInSubmission2[j] || hash1 != hashesForSubmission2[j]) continue;
-                if (isExactMatch(submission1, submission2, i, j, len)) {
-                    for (size_t k = 0; k < len; ++k) {
-                        usedInSubmission1[i + k] = true;
-                        usedInSubmission2[j + k] = true;
-                    }
-                    totalExactMatchLength += len;
-                    break;
-                }
+        }
+        return longest;
+    };
+
+    // Turns the matches into tiles, longest first, skipping those a longer tile already covers.
+    auto mark = [&]() {
+        std::stable_sort(matches.begin(), matches.end(),
+                         [](const Match& a, const Match& b) { return a.length > b.length; });
+        int added = 0;
+        for (const Match& match : matches) {
+            bool occluded = false;
+            for (size_t k = 0; k < match.length && !occluded; ++k) {
+                occluded = usedInSubmission1[match.start1 + k] || usedInSubmission2[match.start2 + k];
             }
+            if (occluded) continue;
+            for (size_t k = 0; k < match.length; ++k) {
+                usedInSubmission1[match.start1 + k] = true;
+                usedInSubmission2[match.start2 + k] = true;
+            }
+            added += match.length;
+        }
+        return added;
+    };
+
+    int totalTileLength = 0;
+    size_t searchLength = std::max(Policy::initialSearchLength, Policy::minimumMatchLength);
+    while (true) {
+        size_t longest = scan(searchLength);
+        if (longest > 2 * searchLength) {
+            searchLength = longest;
+            continue;
+        }
+        int added = mark();
+        totalTileLength += added;
+        if (searchLength > 2 * Policy::minimumMatchLength) {
+            searchLength /= 2;
+        } else if (searchLength > Policy::minimumMatchLength) {
+            searchLength = Policy::minimumMatchLength;
+        } else if (added == 0) {
+            break;
         }
     }
+    return totalTileLength;
 }
 
-// Improved longest common subsequence detection
+// Improved longest common subsequence detection, given the long pattern hashes of
+// submission2 from hashLongPatterns
 void findLongestCommonSubsequence(const std::vector<int>& submission1,
-                                   const std::vector<int>& submission2, int& maxLCSLength,
-                                   int& startIndex1, int& startIndex2) {
+                                   const std::vector<int>& submission2,
+                                   const std::unordered_map<size_t, std::vector<size_t>>& longPatterns2,
+                                   int& maxLCSLength, int& startIndex1, int& startIndex2) {
     const size_t m = submission1.size();
     const size_t n = submission2.size();
-    const int minLength = 30;
-    const double matchThreshold = 0.8;
+    const int minLength = Policy::longPatternWindow;
+    const double matchThreshold = Policy::similarityThreshold;
     std::vector<int> previousRow(n + 1, 0), currentRow(n + 1, 0);
     maxLCSLength = 0; startIndex1 = 0; startIndex2 = 0;
     int currentPatternLength = 0;
@@ -142,39 +253,87 @@ void findLongestCommonSubsequence(const std::vector<int>& submission1,
         std::swap(previousRow, currentRow);
     }
     if (maxLCSLength < minLength) {
-        searchForLongPatterns(submission1, submission2, minLength, 
-                              maxLCSLength, startIndex1, startIndex2);
+        searchForLongPatterns<Policy::longPatternWindow>(submission1, submission2, longPatterns2,
+                                                         maxLCSLength, startIndex1, startIndex2);
     }
     if (maxLCSLength < minLength) {
         maxLCSLength = startIndex1 = startIndex2 = 0;
     }
 }
 
-std::array<int, 5> match_submissions(std::vector<int>& submission1,
-                                     std::vector<int>& submission2) {
+// Window hashes of one submission, built once by prepare() and shared by every
+// compare() the submission takes part in
+struct Prepared {
+    std::vector<int> tokens;
+    WindowHashes exactHashes;
+    std::unordered_map<size_t, std::vector<size_t>> longPatterns;
+};
+
+std::shared_ptr<const Prepared> prepare(const std::vector<int>& submission) {
+    return std::make_shared<const Prepared>(Prepared{submission, WindowHashes(submission),
+                                                     hashLongPatterns<Policy::longPatternWindow>(submission)});
+}
+
+// Whether the exact matches or the longest match are a large enough share of the smaller submission
+bool isSignificant(int totalExactMatchLength, int longestCommonSubsequenceLength, int minSubmissionSize) {
+    const double exactMatch = Policy::exactMatch;
+    const double approximateMatch = Policy::approximateMatch;
+    bool hasSignificantExactMatches = 
+        totalExactMatchLength >= static_cast<int>(minSubmissionSize * exactMatch);
+    bool hasSignificantLongMatch = 
+        longestCommonSubsequenceLength >= static_cast<int>(minSubmissionSize * approximateMatch);
+    return hasSignificantExactMatches || hasSignificantLongMatch;
+}
+
+std::array<int, 5> compare(const Prepared& prepared1, const Prepared& prepared2) {
+    const std::vector<int>& submission1 = prepared1.tokens;
+    const std::vector<int>& submission2 = prepared2.tokens;
     std::array<int, 5> result = {0, 0, 0, 0, 0};
     std::vector<bool> usedInSubmission1(submission1.size(), false);
     std::vector<bool> usedInSubmission2(submission2.size(), false);
 
-    int totalExactMatchLength = 0;
-    detectExactMatches(submission1, submission2, usedInSubmission1, usedInSubmission2, 
-                                                                totalExactMatchLength);
+    // Exact matches: the total length of the greedy string tiling of the two submissions
+    int totalExactMatchLength = greedyStringTiling(submission1, submission2, prepared1.exactHashes,
+                                                   prepared2.exactHashes, usedInSubmission1, usedInSubmission2);
 
     int longestCommonSubsequenceLength = 0, startIndex1 = 0, startIndex2 = 0;
-    findLongestCommonSubsequence(submission1, submission2, longestCommonSubsequenceLength, 
-                                                                startIndex1, startIndex2);
+    findLongestCommonSubsequence(submission1, submission2, prepared2.longPatterns,
+                                 longestCommonSubsequenceLength, startIndex1, startIndex2);
     
-    const double exactMatch = 0.2;
-    const double approximateMatch = 0.3;
     int minSubmissionSize = std::min(submission1.size(), submission2.size());
-    bool hasSignificantExactMatches = 
-        totalExactMatchLength >= static_cast<int>(minSubmissionSize * exactMatch);
-    bool hasSignificantLongMatch = 
-        longestCommonSubsequenceLength >= static_cast<int>(minSubmissionSize * approximateMatch);
-    result[0] = (hasSignificantExactMatches || hasSignificantLongMatch) ? 1 : 0;
+    result[0] = isSignificant(totalExactMatchLength, longestCommonSubsequenceLength, minSubmissionSize) ? 1 : 0;
     result[1] = totalExactMatchLength;
     result[2] = longestCommonSubsequenceLength;
     result[3] = startIndex1;
     result[4] = startIndex2;
     return result;
 }
+
+// Exact matches need a common window of Policy::minimumMatchLength tokens, and a long match either a common run
+// of Policy::longPatternWindow tokens or a window of that size with 80% equal positions, so 24 common tokens. Without
+// them both lengths are 0.
+std::optional<std::array<int, 5>> settle(const cascade::facts_t& facts) {
+    static_assert(Policy::minimumMatchLength == cascade::WINDOW);
+    if (facts.shares_window || facts.common_tokens >= 24) {
+        return std::nullopt;
+    }
+    int minSubmissionSize = std::min(facts.size1, facts.size2);
+    return std::array<int, 5>{isSignificant(0, 0, minSubmissionSize) ? 1 : 0, 0, 0, 0, 0};
+}
+
+std::array<int, 5> match_submissions(std::vector<int>& submission1,
+                                     std::vector<int>& submission2) {
+    if (std::optional<std::array<int, 5>> settled = cascade::try_settle(submission1, submission2, &settle)) {
+        return *settled;
+    }
+    return compare(*prepare(submission1), *prepare(submission2));
+}
+
+} // namespace checker_sample
+
+#ifndef CHECKER_REGISTRY
+std::array<int, 5> match_submissions(std::vector<int>& submission1,
+                                     std::vector<int>& submission2) {
+    return checker_sample::match_submissions(submission1, submission2);
+}
+#endif
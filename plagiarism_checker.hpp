@@ -8,12 +8,230 @@
 #include <chrono>
 #include <unordered_set>
 #include <unordered_map>
+#include <array>
+#include <algorithm>
+#include <span>
 // You are free to add any STL includes above this comment, below the --line--.
 // DO NOT add "using namespace std;" or include any other files/libraries.
 // Also DO NOT add the include "bits/stdc++.h"
 
 // OPTIONAL: Add your helper functions and classes here
 
+// Interface for similarity backends that can be plugged into the checker.
+// Each backend declares its cost so the checker can run cheap fingerprint
+// backends on every candidate and reserve expensive pairwise backends for the
+// few candidates that the fingerprint stage ranks as most similar.
+class similarity_backend_t {
+public:
+    enum class cost_t {
+        fingerprint, // Roughly linear in the token count, safe for every candidate.
+        pairwise     // Quadratic or worse, only run on the top-k candidates.
+    };
+
+    virtual ~similarity_backend_t(void) = default;
+    // Declared cost class of this backend.
+    virtual cost_t cost(void) const = 0;
+    // Returns true if the two token sequences should be treated as plagiarized.
+    virtual bool is_match(std::span<const int> new_tokens,
+                            std::span<const int> old_tokens) = 0;
+};
+
+// Adapts a pairwise checker with the match_submissions(...) signature (see
+// checker_zero.hpp through checker_five.hpp) to the backend interface.
+// A pair is reported as a match when the checker sets result[0].
+class pairwise_backend_t : public similarity_backend_t {
+public:
+    using match_function_t = std::array<int, 5> (*)(std::vector<int>&, std::vector<int>&);
+
+    explicit pairwise_backend_t(match_function_t match_function,
+                                cost_t cost = cost_t::pairwise)
+        : match_function_(match_function), cost_(cost) {}
+
+    cost_t cost(void) const override { return cost_; }
+
+    bool is_match(std::span<const int> new_tokens,
+                    std::span<const int> old_tokens) override {
+        // The checkers take non-const references, so hand them private copies.
+        std::vector<int> submission1(new_tokens.begin(), new_tokens.end());
+        std::vector<int> submission2(old_tokens.begin(), old_tokens.end());
+        return match_function_(submission1, submission2)[0] == 1;
+    }
+
+private:
+    match_function_t match_function_; // Checker invoked for each candidate pair.
+    cost_t cost_; // Cost class reported to the checker.
+};
+
+// Source of submission timestamps. The checker reads the steady clock by
+// default; a virtual clock can be injected so that timing-sensitive decisions
+// do not depend on how fast the machine processes submissions.
+class clock_source_t {
+public:
+    using time_point_t = std::chrono::time_point<std::chrono::steady_clock>;
+
+    virtual ~clock_source_t(void) = default;
+    // Returns the current time of this clock.
+    virtual time_point_t now(void) = 0;
+};
+
+// Clock backed by std::chrono::steady_clock.
+class steady_clock_source_t : public clock_source_t {
+public:
+    time_point_t now(void) override { return std::chrono::steady_clock::now(); }
+};
+
+// Deterministic clock that only moves when it is told to.
+class virtual_clock_t : public clock_source_t {
+public:
+    time_point_t now(void) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return now_;
+    }
+    // Moves the clock forward by the given duration.
+    void advance(std::chrono::milliseconds duration) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        now_ += duration;
+    }
+    // Sets the clock to the given time.
+    void set(time_point_t time) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        now_ = time;
+    }
+
+private:
+    std::mutex mutex_; // Guards now_ against concurrent readers and writers.
+    time_point_t now_{}; // Current time of the clock.
+};
+
+// A submission as it was received: what arrived and at which time.
+struct trace_event_t {
+    std::shared_ptr<submission_t> submission; // The received submission.
+    std::chrono::time_point<std::chrono::steady_clock> timestamp; // When it was received.
+};
+
+// Window lengths and thresholds of the fingerprint checks. compute_fingerprints,
+// the corpus scans and the shards all read them from here.
+struct fingerprint_policy_t {
+    // Tokens of a long window; one long window shared with a stored
+    // submission makes a match.
+    static constexpr int LONG_MATCH_LENGTH = 75;
+    // Tokens of a short window, and of a patchwork window.
+    static constexpr int MIN_MATCH_LENGTH = 15;
+    // Short windows shared with a stored submission that make a match.
+    static constexpr int REQUIRED_MATCHES = 10;
+    // Distinct patchwork hashes shared with the whole corpus that make a
+    // patchwork.
+    static constexpr int REQUIRED_PATTERNS = 20;
+};
+
+// Fingerprints of a single submission, as used by the corpus scans.
+// All hash arrays are sorted so that two fingerprints compare with a linear merge.
+struct corpus_fingerprints_t {
+    std::vector<size_t> long_hashes; // Unique hashes of the long token windows.
+    std::vector<size_t> short_hashes; // Unique hashes of the short token windows.
+    std::vector<int> short_counts; // Number of windows producing each short hash.
+    std::vector<size_t> patch_hashes; // Unique hashes used by the patchwork check.
+    std::vector<int> patch_positions; // First window producing each patchwork hash.
+    std::vector<size_t> patch_windows; // Patchwork hash of every window, in order.
+};
+
+// One entry of a similarity report: a prior submission that resembles the
+// reported one, and the longest token span the two appear to share.
+struct similarity_report_t {
+    std::shared_ptr<submission_t> submission; // The prior submission.
+    int score; // Number of distinct 15-token windows shared with it.
+    int new_start; // Start of the shared span in the reported submission.
+    int old_start; // Start of the shared span in the prior submission.
+    int length; // Length of the shared span in tokens.
+};
+
+// Computes the fingerprints of a tokenized submission.
+corpus_fingerprints_t compute_fingerprints(const std::vector<int>& tokens);
+
+// Returns the indices of the limit highest scores, best first. Ties go to the
+// lower index, i.e. the older submission.
+std::vector<int> rank_candidates(const std::vector<int>& scores, std::size_t limit);
+
+// Structure-of-arrays store for processed submissions.
+// Tokens and fingerprints of all submissions live in a few contiguous arenas
+// indexed by per-submission offsets, so a corpus scan streams through memory
+// instead of chasing one heap allocation per submission. The arenas are first
+// touched by the thread that appends to them, i.e. the worker that scans them,
+// which keeps the pages on that worker's NUMA node under first-touch placement.
+class corpus_store_t {
+public:
+    using time_point_t = std::chrono::time_point<std::chrono::steady_clock>;
+
+    corpus_store_t(void) : token_offsets_(1, 0), long_offsets_(1, 0), 
+                            short_offsets_(1, 0), patch_offsets_(1, 0) {}
+
+    // Appends a submission together with its tokens and fingerprints.
+    void append(std::shared_ptr<submission_t> submission, const std::vector<int>& tokens,
+                time_point_t timestamp, const corpus_fingerprints_t& fingerprints);
+    // Hints the hardware to start loading the fingerprints of the given entry.
+    void prefetch(std::size_t index) const;
+
+    std::size_t size(void) const { return submissions_.size(); }
+    const std::shared_ptr<submission_t>& submission(std::size_t index) const {
+        return submissions_[index];
+    }
+    time_point_t timestamp(std::size_t index) const { return timestamps_[index]; }
+    std::span<const int> tokens(std::size_t index) const {
+        return slice(token_arena_, token_offsets_, index);
+    }
+    std::span<const size_t> long_hashes(std::size_t index) const {
+        return slice(long_arena_, long_offsets_, index);
+    }
+    std::span<const size_t> short_hashes(std::size_t index) const {
+        return slice(short_arena_, short_offsets_, index);
+    }
+    std::span<const size_t> patch_hashes(std::size_t index) const {
+        return slice(patch_arena_, patch_offsets_, index);
+    }
+    std::span<const int> patch_positions(std::size_t index) const {
+        return slice(patch_position_arena_, patch_offsets_, index);
+    }
+
+private:
+    template <typename T>
+    static std::span<const T> slice(const std::vector<T>& arena, 
+                                    const std::vector<std::size_t>& offsets, 
+                                    std::size_t index) {
+        return std::span<const T>(arena.data() + offsets[index], 
+                                    offsets[index + 1] - offsets[index]);
+    }
+
+    std::vector<int> token_arena_; // Tokens of all submissions, back to back.
+    std::vector<std::size_t> token_offsets_; // Start of each submission's tokens.
+    std::vector<size_t> long_arena_; // Long window hashes of all submissions.
+    std::vector<std::size_t> long_offsets_;
+    std::vector<size_t> short_arena_; // Short window hashes of all submissions.
+    std::vector<std::size_t> short_offsets_;
+    std::vector<size_t> patch_arena_; // Patchwork hashes of all submissions.
+    std::vector<int> patch_position_arena_; // First window of each patchwork hash.
+    std::vector<std::size_t> patch_offsets_; // Shared by both patchwork arenas.
+    std::vector<time_point_t> timestamps_; // Time each submission was received.
+    std::vector<std::shared_ptr<submission_t>> submissions_; // Cold data, read on a match.
+};
+
+// Checks the fingerprints of a new submission against a stored submission.
+// A single shared long window, or enough shared short windows, indicate plagiarism.
+bool fingerprints_match(const corpus_fingerprints_t& new_fingerprints, 
+                        const corpus_store_t& corpus, std::size_t index);
+
+// Number of distinct 15-token windows a new submission shares with a stored one.
+int similarity_score(const corpus_fingerprints_t& new_fingerprints, 
+                        const corpus_store_t& corpus, std::size_t index);
+
+// Report entry for a stored submission with the given score: the longest run
+// of consecutive new windows whose hashes the stored submission contains.
+similarity_report_t locate_shared_span(const corpus_fingerprints_t& new_fingerprints, 
+                                        const corpus_store_t& corpus, std::size_t index, 
+                                        int score);
+
+// Worker processes holding the processed submissions, see plagiarism_shards.hpp.
+class shard_coordinator_t;
+
 class plagiarism_checker_t {
     // You should NOT modify the public interface of this class.
 public:
@@ -23,6 +241,34 @@ public:
     ~plagiarism_checker_t(void);
     void add_submission(std::shared_ptr<submission_t> __submission);
 
+    // Registers an additional similarity backend. Backends run in order of
+    // their declared cost after the built-in fingerprint checks find no match.
+    void add_backend(std::shared_ptr<similarity_backend_t> backend);
+    // Sets how many of the highest-ranked candidates pairwise backends see.
+    void set_candidate_limit(std::size_t top_k);
+
+    // Replaces the clock used to timestamp new submissions.
+    void set_clock(std::shared_ptr<clock_source_t> clock);
+    // Sets how close in time two matching submissions must be for both to be flagged.
+    void set_match_window(std::chrono::milliseconds window);
+    // Returns every submission received so far with the timestamp it was given.
+    std::vector<trace_event_t> get_trace(void);
+    // Processes a recorded trace synchronously, as fast as possible, using the
+    // recorded timestamps. Gives the same verdicts as processing it live.
+    void replay(const std::vector<trace_event_t>& trace);
+
+    // Returns the prior submissions most similar to the given one, best first.
+    // The list is empty until the submission has been processed.
+    std::vector<similarity_report_t> get_report(std::shared_ptr<submission_t> submission);
+    // Sets how many prior submissions are kept in each report.
+    void set_report_limit(std::size_t top_k);
+
+    // Moves the processed submissions into the given number of worker
+    // processes, which scan them in parallel for every new submission from
+    // then on. Verdicts, backends and reports stay as they are in a single
+    // process. Throws std::logic_error if the checker is already sharded.
+    void set_shards(std::size_t workers);
+
 protected:
     // TODO: Add members and function signatures here
 
@@ -37,23 +283,66 @@ protected:
 
     // Continuously processes submissions from the queue.
     void worker(); 
+    // Processes submissions in timestamp order.
+    void process_batch(std::vector<SubmissionData>& batch);
+    // Reference to an entry of one of the corpus stores.
+    struct CorpusEntry {
+        const corpus_store_t* corpus; // Store holding the entry.
+        std::size_t index; // Position of the entry in that store.
+    };
+
     // Checks a submission for plagiarism.
     void check_plagiarism(const SubmissionData& new_submission); 
-    // Compares token sequences for plagiarism.
-    bool is_plagiarized(const std::vector<int>& new_tokens, const std::vector<int>& old_tokens); 
+    // Compares fingerprints against a stored submission for plagiarism.
+    bool is_plagiarized(const corpus_fingerprints_t& new_fingerprints, 
+                            const corpus_store_t& corpus, std::size_t index); 
     // Detects patchwork plagiarism.
-    bool check_patchwork(const std::vector<int>& new_tokens, 
-                            const std::vector<const SubmissionData*>& existing_submissions); 
+    bool check_patchwork(const corpus_fingerprints_t& new_fingerprints, 
+                            const corpus_store_t& corpus); 
     // Flags a submission as plagiarized.
     void flag_submission(std::shared_ptr<submission_t> submission); 
+    // Checks a submission against the base corpus here and the shards in the workers.
+    void check_sharded(const SubmissionData& new_submission, 
+                            const corpus_fingerprints_t& fingerprints);
+    // Flags the new submission and, if it arrived shortly after it, the existing one.
+    void flag_match(std::shared_ptr<submission_t> existing, 
+                            std::chrono::time_point<std::chrono::steady_clock> existing_timestamp,
+                            const SubmissionData& new_submission);
+    // Runs the registered backends and returns the index of the first matching
+    // candidate, or -1 if none of them matches.
+    int run_backends(const SubmissionData& new_submission,
+                            const std::vector<CorpusEntry>& candidates,
+                            const std::vector<int>& scores);
+    // Scores every candidate by the number of patchwork hashes it shares.
+    std::vector<int> score_candidates(const corpus_fingerprints_t& new_fingerprints,
+                            const std::vector<CorpusEntry>& candidates);
+    // Records the top-scoring candidates as the report of the new submission.
+    void record_report(const SubmissionData& new_submission,
+                            const corpus_fingerprints_t& new_fingerprints,
+                            const std::vector<CorpusEntry>& candidates,
+                            const std::vector<int>& scores);
 
-    std::vector<SubmissionData> base_submissions_; // Base submissions for comparison.
-    std::vector<SubmissionData> submissions_; // Processed submissions for future checks.
+    corpus_store_t base_corpus_; // Base submissions for comparison.
+    corpus_store_t corpus_; // Processed submissions for future checks.
     std::vector<SubmissionData> queue_; // Pending submissions waiting to be processed.
     std::mutex mutex_; // Ensures thread-safe access to shared resources.
     std::condition_variable cv_; // Notifies worker thread about new work.
     std::thread worker_thread_; // Background thread for processing submissions.
     bool stop_thread_; // Flag to signal the worker thread to stop.
+    std::vector<std::shared_ptr<similarity_backend_t>> backends_; // Sorted by cost.
+    std::size_t candidate_limit_ = 5; // Candidates handed to pairwise backends.
+    std::size_t report_limit_ = 5; // Entries kept per similarity report.
+    // Clock used to timestamp new submissions.
+    std::shared_ptr<clock_source_t> clock_ = std::make_shared<steady_clock_source_t>();
+    // Matches closer than this in time flag both submissions.
+    std::chrono::milliseconds match_window_{1500};
+    std::vector<trace_event_t> trace_; // Every submission received, in arrival order.
+    std::mutex process_mutex_; // Serializes live processing and replays.
+    // Similarity reports of processed submissions.
+    std::unordered_map<std::shared_ptr<submission_t>, 
+                        std::vector<similarity_report_t>> reports_;
+    // Set by set_shards; processed submissions then live in its workers.
+    std::shared_ptr<shard_coordinator_t> shards_;
 
     // End TODO
 };
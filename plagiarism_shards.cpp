@@ -0,0 +1,569 @@
+#include "plagiarism_shards.hpp"
+// -----------------------------------------------------------------------------
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Wire protocol. Every message is a 32-bit byte length followed by the payload.
+// Requests start with a one-byte command; integers, hash arrays and candidate
+// arrays are sent in the native layout, since both ends run on the same host.
+//
+//   query   top_k, fingerprints (long, short, short counts, patch hashes,
+//           patch windows)
+//           -> id of the first matching submission of the shard or -1,
+//              the shard's top_k shard_candidate_t, and the patchwork
+//              hashes the shard shares
+//   store   global id, tokens, fingerprints (long, short, patch hashes,
+//           patch positions)
+//   fetch   global ids of the shard -> the tokens of each
+//   stop    no payload, the worker exits
+
+namespace {
+
+enum class command_t : std::uint8_t {
+    query = 1,
+    store = 2,
+    fetch = 3,
+    stop = 4,
+};
+
+// Byte buffer holding one message, written and read front to back.
+class message_t {
+public:
+    template <typename T>
+    void put(T value) {
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(&value);
+        bytes_.insert(bytes_.end(), data, data + sizeof(T));
+    }
+
+    template <typename T>
+    void put_array(std::span<const T> values) {
+        put<std::uint32_t>(static_cast<std::uint32_t>(values.size()));
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(values.data());
+        bytes_.insert(bytes_.end(), data, data + values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    T get(void) {
+        T value;
+        take(&value, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> get_array(void) {
+        std::vector<T> values(get<std::uint32_t>());
+        take(values.data(), values.size() * sizeof(T));
+        return values;
+    }
+
+    std::vector<unsigned char>& bytes(void) { return bytes_; }
+    const std::vector<unsigned char>& bytes(void) const { return bytes_; }
+
+    void clear(void) {
+        bytes_.clear();
+        read_ = 0;
+    }
+
+private:
+    void take(void* data, std::size_t size) {
+        if (size == 0) {
+            return;
+        }
+        if (bytes_.size() - read_ < size) {
+            throw std::runtime_error("truncated shard message");
+        }
+        std::memcpy(data, bytes_.data() + read_, size);
+        read_ += size;
+    }
+
+    std::vector<unsigned char> bytes_;
+    std::size_t read_ = 0;
+};
+
+void write_all(int socket, const void* data, std::size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        // MSG_NOSIGNAL turns a vanished peer into an error instead of SIGPIPE.
+        ssize_t written = ::send(socket, bytes, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "shard send");
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+// Returns false if the peer closed the socket before all bytes arrived.
+bool read_all(int socket, void* data, std::size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t received = ::read(socket, bytes, size);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "shard receive");
+        }
+        if (received == 0) {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+void send_message(int socket, const message_t& message) {
+    std::uint32_t length = static_cast<std::uint32_t>(message.bytes().size());
+    write_all(socket, &length, sizeof(length));
+    write_all(socket, message.bytes().data(), message.bytes().size());
+}
+
+bool receive_message(int socket, message_t& message) {
+    message.clear();
+    std::uint32_t length;
+    if (!read_all(socket, &length, sizeof(length))) {
+        return false;
+    }
+    message.bytes().resize(length);
+    return read_all(socket, message.bytes().data(), length);
+}
+
+// Query payload: everything a worker compares against its shard.
+void put_query(message_t& message, const corpus_fingerprints_t& fingerprints) {
+    message.put_array<size_t>(fingerprints.long_hashes);
+    message.put_array<size_t>(fingerprints.short_hashes);
+    message.put_array<int>(fingerprints.short_counts);
+    message.put_array<size_t>(fingerprints.patch_hashes);
+    message.put_array<size_t>(fingerprints.patch_windows);
+}
+
+corpus_fingerprints_t get_query(message_t& message) {
+    corpus_fingerprints_t fingerprints;
+    fingerprints.long_hashes = message.get_array<size_t>();
+    fingerprints.short_hashes = message.get_array<size_t>();
+    fingerprints.short_counts = message.get_array<int>();
+    fingerprints.patch_hashes = message.get_array<size_t>();
+    fingerprints.patch_windows = message.get_array<size_t>();
+    return fingerprints;
+}
+
+// Scans a shard for a query and writes the reply.
+void answer_query(const corpus_store_t& shard, const std::vector<std::int64_t>& ids,
+                    const corpus_fingerprints_t& fingerprints, std::size_t top_k,
+                    message_t& reply) {
+    std::int64_t first_match = -1;
+    for (std::size_t i = 0; i < shard.size(); ++i) {
+        shard.prefetch(i + 1);
+        if (fingerprints_match(fingerprints, shard, i)) {
+            // Shard entries are in global order, so the first match is the
+            // smallest id this shard can offer.
+            first_match = ids[i];
+            break;
+        }
+    }
+    reply.put<std::int64_t>(first_match);
+
+    // The report and the backends need the shard's best candidates whatever
+    // the verdict, as in plagiarism_checker_t::check_plagiarism.
+    std::vector<int> scores(shard.size());
+    for (std::size_t i = 0; i < shard.size(); ++i) {
+        shard.prefetch(i + 1);
+        scores[i] = similarity_score(fingerprints, shard, i);
+    }
+    std::vector<shard_candidate_t> ranked;
+    for (int i : rank_candidates(scores, top_k)) {
+        shard_candidate_t candidate = {ids[i], scores[i], 0, 0, 0};
+        if (scores[i] > 0) {
+            similarity_report_t span = locate_shared_span(fingerprints, shard, i, scores[i]);
+            candidate.new_start = span.new_start;
+            candidate.old_start = span.old_start;
+            candidate.length = span.length;
+        }
+        ranked.push_back(candidate);
+    }
+    reply.put_array<shard_candidate_t>(ranked);
+
+    // Collect the distinct patchwork hashes shared with the shard. Stopping at
+    // the threshold is enough: the coordinator only needs to know whether the
+    // union over all shards reaches it.
+    const std::vector<size_t>& new_hashes = fingerprints.patch_hashes;
+    std::vector<bool> matched(new_hashes.size(), false);
+    std::vector<size_t> shared;
+    for (std::size_t index = 0; first_match < 0 && index < shard.size() 
+            && shared.size() < static_cast<std::size_t>(fingerprint_policy_t::REQUIRED_PATTERNS); ++index) {
+        shard.prefetch(index + 1);
+        std::span<const size_t> old_hashes = shard.patch_hashes(index);
+        std::size_t i = 0, j = 0;
+        while (i < new_hashes.size() && j < old_hashes.size()) {
+            if (new_hashes[i] < old_hashes[j]) {
+                ++i;
+            } else if (old_hashes[j] < new_hashes[i]) {
+                ++j;
+            } else {
+                if (!matched[i]) {
+                    matched[i] = true;
+                    shared.push_back(new_hashes[i]);
+                }
+                ++i;
+                ++j;
+            }
+        }
+    }
+    reply.put_array<size_t>(shared);
+}
+
+// Main loop of a worker process. The shard is built in the worker itself, so
+// its arenas are first touched where they are scanned.
+void run_worker(int socket) {
+    corpus_store_t shard;
+    std::vector<std::int64_t> ids; // Global id of every shard entry.
+    message_t request, reply;
+    while (receive_message(socket, request)) {
+        command_t command = request.get<command_t>();
+        if (command == command_t::query) {
+            std::size_t top_k = request.get<std::uint32_t>();
+            corpus_fingerprints_t fingerprints = get_query(request);
+            reply.clear();
+            answer_query(shard, ids, fingerprints, top_k, reply);
+            send_message(socket, reply);
+        } else if (command == command_t::store) {
+            std::int64_t id = request.get<std::int64_t>();
+            std::vector<int> tokens = request.get_array<int>();
+            corpus_fingerprints_t fingerprints;
+            fingerprints.long_hashes = request.get_array<size_t>();
+            fingerprints.short_hashes = request.get_array<size_t>();
+            fingerprints.patch_hashes = request.get_array<size_t>();
+            fingerprints.patch_positions = request.get_array<int>();
+            // Timestamps stay with the coordinator, which decides the verdicts.
+            shard.append(nullptr, tokens, shard_coordinator_t::time_point_t{}, fingerprints);
+            ids.push_back(id);
+        } else if (command == command_t::fetch) {
+            std::vector<std::int64_t> wanted = request.get_array<std::int64_t>();
+            reply.clear();
+            for (std::int64_t id : wanted) {
+                std::size_t i = std::lower_bound(ids.begin(), ids.end(), id) - ids.begin();
+                reply.put_array<int>(shard.tokens(i));
+            }
+            send_message(socket, reply);
+        } else {
+            break;
+        }
+    }
+}
+
+} // namespace
+
+shard_coordinator_t::shard_coordinator_t(std::size_t workers) {
+    if (workers == 0) {
+        workers = 1;
+    }
+    for (std::size_t w = 0; w < workers; ++w) {
+        int sockets[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+            int error = errno;
+            stop();
+            throw std::system_error(error, std::generic_category(), "shard socketpair");
+        }
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            int error = errno;
+            ::close(sockets[0]);
+            ::close(sockets[1]);
+            stop();
+            throw std::system_error(error, std::generic_category(), "shard fork");
+        }
+        if (pid == 0) {
+            // Worker: keep only its own end, so that earlier workers see the
+            // coordinator hang up when it goes away.
+            ::close(sockets[0]);
+            for (const worker_t& worker : workers_) {
+                ::close(worker.socket);
+            }
+            int status = 0;
+            try {
+                run_worker(sockets[1]);
+            } catch (...) {
+                status = 1;
+            }
+            ::_exit(status);
+        }
+        ::close(sockets[1]);
+        workers_.push_back({sockets[0], static_cast<int>(pid)});
+    }
+}
+
+shard_coordinator_t::~shard_coordinator_t(void) {
+    stop();
+}
+
+void shard_coordinator_t::stop(void) {
+    message_t message;
+    message.put(command_t::stop);
+    for (const worker_t& worker : workers_) {
+        try {
+            send_message(worker.socket, message);
+        } catch (const std::system_error&) {
+            // The worker is already gone; closing the socket is all that is left.
+        }
+        ::close(worker.socket);
+    }
+    for (const worker_t& worker : workers_) {
+        while (::waitpid(static_cast<pid_t>(worker.pid), nullptr, 0) < 0 && errno == EINTR) {
+        }
+    }
+    workers_.clear();
+}
+
+shard_verdict_t shard_coordinator_t::query(const corpus_fingerprints_t& fingerprints,
+                                            std::size_t top_k) {
+    // Broadcast the query first and gather afterwards, so the shards are
+    // scanned concurrently.
+    message_t message;
+    message.put(command_t::query);
+    message.put<std::uint32_t>(static_cast<std::uint32_t>(top_k));
+    put_query(message, fingerprints);
+    for (const worker_t& worker : workers_) {
+        send_message(worker.socket, message);
+    }
+
+    shard_verdict_t verdict = {-1, {}, {}};
+    for (const worker_t& worker : workers_) {
+        if (!receive_message(worker.socket, message)) {
+            throw std::runtime_error("shard worker disconnected");
+        }
+        std::int64_t id = message.get<std::int64_t>();
+        if (id >= 0 && (verdict.first_match < 0 || id < verdict.first_match)) {
+            verdict.first_match = id;
+        }
+        std::vector<shard_candidate_t> ranked = message.get_array<shard_candidate_t>();
+        verdict.ranked.insert(verdict.ranked.end(), ranked.begin(), ranked.end());
+        std::vector<size_t> hashes = message.get_array<size_t>();
+        verdict.shared_patterns.insert(verdict.shared_patterns.end(), hashes.begin(), hashes.end());
+    }
+
+    std::sort(verdict.ranked.begin(), verdict.ranked.end(),
+              [](const shard_candidate_t& a, const shard_candidate_t& b) {
+                  return a.score != b.score ? a.score > b.score : a.id < b.id;
+              });
+    if (verdict.ranked.size() > top_k) {
+        verdict.ranked.resize(top_k);
+    }
+    std::vector<size_t>& shared = verdict.shared_patterns;
+    std::sort(shared.begin(), shared.end());
+    shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+    return verdict;
+}
+
+void shard_coordinator_t::store(std::shared_ptr<submission_t> submission,
+                                std::span<const int> tokens, time_point_t timestamp,
+                                const corpus_fingerprints_t& fingerprints) {
+    message_t message;
+    message.put(command_t::store);
+    message.put<std::int64_t>(static_cast<std::int64_t>(submissions_.size()));
+    message.put_array<int>(tokens);
+    message.put_array<size_t>(fingerprints.long_hashes);
+    message.put_array<size_t>(fingerprints.short_hashes);
+    message.put_array<size_t>(fingerprints.patch_hashes);
+    message.put_array<int>(fingerprints.patch_positions);
+    send_message(workers_[submissions_.size() % workers_.size()].socket, message);
+    submissions_.push_back(std::move(submission));
+    timestamps_.push_back(timestamp);
+}
+
+std::vector<std::vector<int>> shard_coordinator_t::fetch(const std::vector<std::int64_t>& ids) {
+    // Ask every shard for its share of the ids, then gather in the same order.
+    std::vector<std::vector<std::int64_t>> wanted(workers_.size());
+    for (std::int64_t id : ids) {
+        wanted[static_cast<std::size_t>(id) % workers_.size()].push_back(id);
+    }
+    message_t message;
+    for (std::size_t w = 0; w < workers_.size(); ++w) {
+        if (wanted[w].empty()) {
+            continue;
+        }
+        message.clear();
+        message.put(command_t::fetch);
+        message.put_array<std::int64_t>(wanted[w]);
+        send_message(workers_[w].socket, message);
+    }
+
+    std::vector<std::vector<int>> tokens(ids.size());
+    for (std::size_t w = 0; w < workers_.size(); ++w) {
+        if (wanted[w].empty()) {
+            continue;
+        }
+        if (!receive_message(workers_[w].socket, message)) {
+            throw std::runtime_error("shard worker disconnected");
+        }
+        for (std::int64_t id : wanted[w]) {
+            std::size_t k = std::lower_bound(ids.begin(), ids.end(), id) - ids.begin();
+            tokens[k] = message.get_array<int>();
+        }
+    }
+    return tokens;
+}
+
+// Moves the processed submissions into the workers of a new coordinator.
+void plagiarism_checker_t::set_shards(std::size_t workers) {
+    std::unique_lock<std::mutex> process_lock(process_mutex_);
+    if (shards_) {
+        throw std::logic_error("plagiarism checker is already sharded");
+    }
+    auto shards = std::make_shared<shard_coordinator_t>(workers);
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (std::size_t i = 0; i < corpus_.size(); ++i) {
+        corpus_fingerprints_t fingerprints;
+        fingerprints.long_hashes.assign(corpus_.long_hashes(i).begin(), corpus_.long_hashes(i).end());
+        fingerprints.short_hashes.assign(corpus_.short_hashes(i).begin(), corpus_.short_hashes(i).end());
+        fingerprints.patch_hashes.assign(corpus_.patch_hashes(i).begin(), corpus_.patch_hashes(i).end());
+        fingerprints.patch_positions.assign(corpus_.patch_positions(i).begin(), 
+                                            corpus_.patch_positions(i).end());
+        shards->store(corpus_.submission(i), corpus_.tokens(i), corpus_.timestamp(i), fingerprints);
+    }
+    corpus_ = corpus_store_t();
+    shards_ = std::move(shards);
+}
+
+// Same steps as check_plagiarism, in the same order: report, base
+// submissions, stored submissions, backends, patchwork, store. Candidates are
+// numbered as there too, base submissions first and stored ones by id, so
+// ties are broken the same way.
+void plagiarism_checker_t::check_sharded(const SubmissionData& new_submission, 
+                                            const corpus_fingerprints_t& fingerprints) {
+    std::vector<std::shared_ptr<similarity_backend_t>> backends;
+    std::size_t candidate_limit, report_limit;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        backends = backends_;
+        candidate_limit = backends_.empty() ? 0 : candidate_limit_;
+        report_limit = report_limit_;
+    }
+
+    // Base submissions stay in this process; the shards scan concurrently.
+    std::vector<CorpusEntry> base;
+    for (std::size_t i = 0; i < base_corpus_.size(); ++i) {
+        base.push_back({&base_corpus_, i});
+    }
+    std::size_t top_k = std::max(candidate_limit, report_limit);
+    std::vector<int> base_scores = score_candidates(fingerprints, base);
+    shard_verdict_t verdict = shards_->query(fingerprints, top_k);
+
+    // Merge the best base candidates with the best stored ones. Stored
+    // candidates outside the shards' top_k cannot be among the top_k overall.
+    std::vector<std::pair<int, std::int64_t>> ranked; // (score, candidate number)
+    for (int i : rank_candidates(base_scores, top_k)) {
+        ranked.push_back({base_scores[i], i});
+    }
+    std::int64_t base_count = static_cast<std::int64_t>(base.size());
+    for (const shard_candidate_t& candidate : verdict.ranked) {
+        ranked.push_back({candidate.score, base_count + candidate.id});
+    }
+    std::sort(ranked.begin(), ranked.end(), 
+              [](const std::pair<int, std::int64_t>& a, const std::pair<int, std::int64_t>& b) {
+                  return a.first != b.first ? a.first > b.first : a.second < b.second;
+              });
+
+    std::vector<similarity_report_t> report;
+    for (std::size_t r = 0; r < ranked.size() && r < report_limit && ranked[r].first > 0; ++r) {
+        std::int64_t number = ranked[r].second;
+        if (number < base_count) {
+            report.push_back(locate_shared_span(fingerprints, base_corpus_, 
+                                                static_cast<std::size_t>(number), ranked[r].first));
+            continue;
+        }
+        auto candidate = std::find_if(verdict.ranked.begin(), verdict.ranked.end(),
+                                      [&](const shard_candidate_t& c) {
+                                          return c.id == number - base_count;
+                                      });
+        report.push_back({shards_->submission(candidate->id), candidate->score, 
+                            candidate->new_start, candidate->old_start, candidate->length});
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        reports_[new_submission.submission] = std::move(report);
+    }
+
+    // Check for plagiarism against base submissions.
+    for (std::size_t i = 0; i < base_corpus_.size(); ++i) {
+        base_corpus_.prefetch(i + 1);
+        if (is_plagiarized(fingerprints, base_corpus_, i)) {
+            flag_submission(new_submission.submission);
+            return;
+        }
+    }
+
+    // The smallest matching id is the submission a single process finds first.
+    if (verdict.first_match >= 0) {
+        flag_match(shards_->submission(verdict.first_match), 
+                    shards_->timestamp(verdict.first_match), new_submission);
+        return;
+    }
+
+    if (!backends.empty()) {
+        // Fingerprint backends see every candidate, so their tokens are all
+        // fetched; pairwise backends only need the best-ranked stored ones.
+        // Others get the score -1, which ranks them below those.
+        bool every_candidate = std::any_of(backends.begin(), backends.end(), 
+            [](const std::shared_ptr<similarity_backend_t>& backend) {
+                return backend->cost() == similarity_backend_t::cost_t::fingerprint;
+            });
+        std::vector<std::int64_t> ids;
+        std::vector<int> scores = base_scores;
+        if (every_candidate) {
+            for (std::size_t id = 0; id < shards_->size(); ++id) {
+                ids.push_back(static_cast<std::int64_t>(id));
+            }
+        } else {
+            for (std::size_t r = 0; r < ranked.size() && r < candidate_limit; ++r) {
+                if (ranked[r].second >= base_count) {
+                    ids.push_back(ranked[r].second - base_count);
+                }
+            }
+            std::sort(ids.begin(), ids.end());
+        }
+        std::vector<std::vector<int>> tokens = shards_->fetch(ids);
+        corpus_store_t fetched;
+        std::vector<CorpusEntry> candidates = base;
+        for (std::size_t k = 0; k < ids.size(); ++k) {
+            fetched.append(shards_->submission(ids[k]), tokens[k], shards_->timestamp(ids[k]), 
+                            corpus_fingerprints_t());
+            candidates.push_back({&fetched, k});
+            int score = -1;
+            for (const shard_candidate_t& candidate : verdict.ranked) {
+                if (candidate.id == ids[k]) {
+                    score = candidate.score;
+                }
+            }
+            scores.push_back(score);
+        }
+
+        int match = run_backends(new_submission, candidates, scores);
+        if (match >= 0) {
+            const CorpusEntry& candidate = candidates[match];
+            if (candidate.corpus == &base_corpus_) {
+                flag_submission(new_submission.submission);
+            } else {
+                flag_match(candidate.corpus->submission(candidate.index), 
+                            candidate.corpus->timestamp(candidate.index), new_submission);
+            }
+            return;
+        }
+    }
+
+    // The union of the hashes the shards share decides the patchwork verdict.
+    if (verdict.shared_patterns.size() >= static_cast<std::size_t>(fingerprint_policy_t::REQUIRED_PATTERNS)) {
+        flag_submission(new_submission.submission);
+    }
+
+    shards_->store(new_submission.submission, new_submission.tokens, 
+                    new_submission.timestamp, fingerprints);
+}
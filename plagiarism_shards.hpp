@@ -0,0 +1,78 @@
+#pragma once
+
+#include "plagiarism_checker.hpp"
+// -----------------------------------------------------------------------------
+#include <cstdint>
+
+// A stored submission a shard ranks among the most similar to a new one.
+struct shard_candidate_t {
+    std::int64_t id; // Global id of the stored submission.
+    std::int32_t score; // Number of distinct 15-token windows shared with it.
+    std::int32_t new_start; // Shared span, as in similarity_report_t.
+    std::int32_t old_start;
+    std::int32_t length;
+};
+
+// What the shards found for a new submission, gathered over all workers.
+struct shard_verdict_t {
+    // Smallest id of a stored submission the fingerprints match, or -1.
+    std::int64_t first_match;
+    // The top_k candidates of every shard, merged, best first; ties go to the
+    // smaller id. Together these hold the top_k candidates of all shards.
+    std::vector<shard_candidate_t> ranked;
+    // Distinct patchwork hashes shared with the stored submissions, sorted.
+    // Only gathered without a match, and only up to the patchwork threshold.
+    std::vector<size_t> shared_patterns;
+};
+
+// Coordinator of the sharded mode of plagiarism_checker_t (set_shards).
+// Processed submissions are split into shards, each held by a worker process
+// connected to the coordinator through a local socket; submission i lives in
+// shard i % workers. The checker fingerprints a new submission once and the
+// coordinator broadcasts the fingerprints to all workers, which scan their
+// shards in parallel and reply with their first match, their best-ranked
+// candidates and the patchwork hashes they share. Tokens stay in the workers
+// and are fetched only for the candidates the backends examine.
+//
+// Workers are forked by the constructor and run only their own loop, so the
+// coordinator may be created while other threads of the process are running.
+class shard_coordinator_t {
+public:
+    using time_point_t = std::chrono::time_point<std::chrono::steady_clock>;
+
+    explicit shard_coordinator_t(std::size_t workers);
+    ~shard_coordinator_t(void);
+
+    shard_coordinator_t(const shard_coordinator_t&) = delete;
+    shard_coordinator_t& operator=(const shard_coordinator_t&) = delete;
+
+    // Scans every shard for a new submission; see shard_verdict_t.
+    shard_verdict_t query(const corpus_fingerprints_t& fingerprints, std::size_t top_k);
+    // Stores a submission in the next shard under the id size().
+    void store(std::shared_ptr<submission_t> submission, std::span<const int> tokens,
+                time_point_t timestamp, const corpus_fingerprints_t& fingerprints);
+    // Returns the tokens of the given stored submissions; ids must be sorted.
+    std::vector<std::vector<int>> fetch(const std::vector<std::int64_t>& ids);
+
+    std::size_t workers(void) const { return workers_.size(); }
+    std::size_t size(void) const { return submissions_.size(); }
+    const std::shared_ptr<submission_t>& submission(std::int64_t id) const {
+        return submissions_[static_cast<std::size_t>(id)];
+    }
+    time_point_t timestamp(std::int64_t id) const {
+        return timestamps_[static_cast<std::size_t>(id)];
+    }
+
+private:
+    struct worker_t {
+        int socket; // Coordinator end of the socket pair.
+        int pid; // Process id of the worker.
+    };
+
+    void stop(void);
+
+    std::vector<worker_t> workers_;
+    // Stored submissions and their timestamps by global id.
+    std::vector<std::shared_ptr<submission_t>> submissions_;
+    std::vector<time_point_t> timestamps_;
+};
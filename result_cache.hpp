@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+// Cache of checker results keyed by the checker and the contents of the two
+// submissions, so resubmissions with identical tokens and repeated sweeps
+// are answered without running the checker again.
+//
+// The checker id is whatever string the caller uses for it. It must change
+// whenever the checker's results can change, e.g. the checker name plus a
+// revision or threshold setting; the cache itself cannot tell.
+//
+// Contents are identified by a 128-bit fingerprint of the token sequence,
+// from two independent 64-bit hashes. The cache is safe to use from several
+// threads and can be saved to and loaded from a text file with one line per
+// entry: "checker first second r0 r1 r2 r3 r4", fingerprints in hex.
+namespace result_cache {
+
+struct fingerprint_t {
+    std::uint64_t high;
+    std::uint64_t low;
+
+    auto operator<=>(const fingerprint_t&) const = default;
+};
+
+namespace detail {
+
+// splitmix64 finalizer.
+inline std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace detail
+
+// Fingerprint of a token sequence; the length is part of it.
+inline fingerprint_t fingerprint(std::span<const int> tokens) {
+    std::uint64_t high = 0xcbf29ce484222325ull ^ tokens.size(); // FNV-1a.
+    std::uint64_t low = detail::mix(tokens.size());
+    for (int token : tokens) {
+        std::uint64_t value = static_cast<std::uint32_t>(token);
+        high = (high ^ value) * 0x100000001b3ull;
+        low = detail::mix(low ^ value);
+    }
+    return {high, low};
+}
+
+class cache_t {
+public:
+    using result_t = std::array<int, 5>;
+
+    // The cached result of checker on (first, second). If the checker is
+    // symmetric, i.e. its result on (second, first) is the same with the start
+    // indices result[3] and result[4] swapped, an entry for the reverse pair
+    // is used as well.
+    std::optional<result_t> find(std::string_view checker, const fingerprint_t& first,
+                                 const fingerprint_t& second, bool symmetric = false) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(key_t{std::string(checker), first, second});
+        if (found != entries_.end()) {
+            return found->second;
+        }
+        if (symmetric) {
+            found = entries_.find(key_t{std::string(checker), second, first});
+            if (found != entries_.end()) {
+                result_t result = found->second;
+                std::swap(result[3], result[4]);
+                return result;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void insert(std::string_view checker, const fingerprint_t& first,
+                const fingerprint_t& second, const result_t& result) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.insert_or_assign(key_t{std::string(checker), first, second}, result);
+    }
+
+    // The cached result if there is one, else compute() stored and returned.
+    // compute runs without the lock held, so two threads may both compute a
+    // missing entry; they store the same result.
+    template <typename Compute>
+    result_t find_or_compute(std::string_view checker, const fingerprint_t& first,
+                             const fingerprint_t& second, bool symmetric, Compute compute) {
+        if (std::optional<result_t> result = find(checker, first, second, symmetric)) {
+            return *result;
+        }
+        result_t result = compute();
+        insert(checker, first, second, result);
+        return result;
+    }
+
+    std::size_t size(void) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    // Adds the entries of a saved cache. Returns false if the file cannot be
+    // read; lines that do not parse are skipped, as they can be recomputed.
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            key_t key;
+            result_t result;
+            if (!(fields >> key.checker) || !read_fingerprint(fields, key.first)
+                    || !read_fingerprint(fields, key.second)) {
+                continue;
+            }
+            bool complete = true;
+            for (int& value : result) {
+                complete = complete && static_cast<bool>(fields >> value);
+            }
+            if (complete) {
+                entries_.insert_or_assign(std::move(key), result);
+            }
+        }
+        return true;
+    }
+
+    // Writes all entries to a temporary file next to path and renames it over
+    // path, so a reader never sees a half-written cache. Returns false on failure.
+    bool save(const std::string& path) const {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& [key, result] : entries_) {
+                out << key.checker << ' ' << hex(key.first) << ' ' << hex(key.second);
+                for (int value : result) {
+                    out << ' ' << value;
+                }
+                out << '\n';
+            }
+            if (!out.flush()) {
+                return false;
+            }
+        }
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    struct key_t {
+        std::string checker;
+        fingerprint_t first;
+        fingerprint_t second;
+
+        bool operator<(const key_t& other) const {
+            return std::tie(checker, first, second) < std::tie(other.checker, other.first, other.second);
+        }
+    };
+
+    static std::string hex(const fingerprint_t& fingerprint) {
+        char text[33];
+        std::snprintf(text, sizeof(text), "%016llx%016llx",
+                      static_cast<unsigned long long>(fingerprint.high),
+                      static_cast<unsigned long long>(fingerprint.low));
+        return text;
+    }
+
+    static bool read_fingerprint(std::istream& in, fingerprint_t& fingerprint) {
+        std::string text;
+        if (!(in >> text) || text.size() != 32
+                || text.find_first_not_of("0123456789abcdef") != std::string::npos) {
+            return false;
+        }
+        fingerprint.high = std::stoull(text.substr(0, 16), nullptr, 16);
+        fingerprint.low = std::stoull(text.substr(16), nullptr, 16);
+        return true;
+    }
+
+    mutable std::mutex mutex_;
+    std::map<key_t, result_t> entries_;
+};
+
+} // namespace result_cache
@@ -0,0 +1,212 @@
+// Throughput of plagiarism_checker_t in one process and with its processed
+// submissions sharded over worker processes (set_shards).
+//
+// Build, adding whatever the course's structures.hpp needs for tokenizer_t:
+//   g++ -std=c++20 -O2 -pthread -o shard_benchmark shard_benchmark.cpp plagiarism_checker.cpp plagiarism_shards.cpp
+//
+// The submissions are generated as source files of C++ keywords and
+// punctuators in a temporary directory, so the tokenizer gives every word its
+// own token. Every fourth submission copies a block from an earlier one and
+// every tenth is a lightly edited copy of one, so there are flags and
+// reports to get right. The trace is replayed with timestamps 100 ms apart,
+// first in one process and then with each worker count, and every run must
+// give the same similarity reports as the first.
+//
+// Options:
+//   --submissions=N     submissions replayed per run (default: 2000)
+//   --tokens=N          tokens per submission (default: 600)
+//   --base=N            base submissions given to the constructor (default: 20)
+//   --workers=1,2,...   worker counts (default: 1 and every power of two up
+//                       to the core count)
+//   --backend           register checker_sample as a pairwise backend
+#include "plagiarism_shards.hpp"
+#include "match_submissions.hpp"
+// -----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// Words the tokenizer keeps apart, from very common to rare.
+const char* const VOCABULARY[] = {
+    ";", "(", ")", "{", "}", ",", "=", "+", "<", "[", "]", "int", "return", "if",
+    "for", "-", "*", "==", "else", "++", "while", "&&", "!", "!=", ">", "<=",
+    ">=", "||", "/", "%", "+=", "-=", "bool", "char", "double", "break",
+    "continue", "true", "false", "const", "auto", "void", "::", "?", ":",
+    "case", "switch", "do", "long", "static",
+};
+constexpr int VOCABULARY_SIZE = sizeof(VOCABULARY) / sizeof(VOCABULARY[0]);
+
+struct options_t {
+    int submissions = 2000;
+    int tokens = 600;
+    int base = 20;
+    std::vector<std::size_t> workers;
+    bool backend = false;
+};
+
+options_t parse_options(int argc, char** argv) {
+    options_t options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--submissions") {
+            options.submissions = std::atoi(value.c_str());
+        } else if (key == "--tokens") {
+            options.tokens = std::atoi(value.c_str());
+        } else if (key == "--base") {
+            options.base = std::atoi(value.c_str());
+        } else if (key == "--workers") {
+            std::size_t start = 0;
+            while (start < value.size()) {
+                std::size_t comma = value.find(',', start);
+                comma = comma == std::string::npos ? value.size() : comma;
+                options.workers.push_back(std::atoi(value.substr(start, comma - start).c_str()));
+                start = comma + 1;
+            }
+        } else if (key == "--backend") {
+            options.backend = true;
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            std::exit(2);
+        }
+    }
+    if (options.workers.empty()) {
+        std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t count = 1; count <= cores; count *= 2) {
+            options.workers.push_back(count);
+        }
+        if (options.workers.back() != cores) {
+            options.workers.push_back(cores);
+        }
+    }
+    return options;
+}
+
+std::vector<int> random_words(std::mt19937& rng, int size) {
+    std::geometric_distribution<int> word(0.12);
+    std::vector<int> words(size);
+    for (int& w : words) {
+        w = std::min(word(rng), VOCABULARY_SIZE - 1);
+    }
+    return words;
+}
+
+// Writes the words as a source file and returns a submission for it.
+std::shared_ptr<submission_t> make_submission(const std::string& directory, long id,
+                                              const std::vector<int>& words) {
+    std::string path = directory + "/" + std::to_string(id) + ".cpp";
+    std::ofstream out(path);
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        out << VOCABULARY[words[i]] << (i % 16 == 15 ? '\n' : ' ');
+    }
+    auto submission = std::make_shared<submission_t>();
+    submission->id = id;
+    submission->codefile = path;
+    submission->student = std::make_shared<student_t>();
+    submission->professor = std::make_shared<educator_t>();
+    return submission;
+}
+
+using report_key_t = std::vector<std::array<long, 5>>;
+
+} // namespace
+
+int main(int argc, char** argv) {
+    options_t options = parse_options(argc, argv);
+    char directory_template[] = "/tmp/shard_benchmark.XXXXXX";
+    if (::mkdtemp(directory_template) == nullptr) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string directory = directory_template;
+
+    std::mt19937 rng(2024);
+    std::vector<std::vector<int>> words;
+    std::vector<std::shared_ptr<submission_t>> base;
+    for (int i = 0; i < options.base; ++i) {
+        words.push_back(random_words(rng, options.tokens));
+        base.push_back(make_submission(directory, i, words.back()));
+    }
+    std::vector<trace_event_t> trace;
+    auto start_time = std::chrono::steady_clock::time_point{} + std::chrono::hours(1);
+    for (int i = 0; i < options.submissions; ++i) {
+        std::vector<int> submission = random_words(rng, options.tokens);
+        std::uniform_int_distribution<int> earlier(0, static_cast<int>(words.size()) - 1);
+        const std::vector<int>& source = words[earlier(rng)];
+        if (i % 10 == 9) {
+            // Substitute about 8% of the tokens of an earlier submission.
+            submission = source;
+            for (int& w : submission) {
+                if (rng() % 100 < 8) {
+                    w = random_words(rng, 1)[0];
+                }
+            }
+        } else if (i % 4 == 3) {
+            int length = std::min<int>(options.tokens / 5, static_cast<int>(source.size()));
+            std::uniform_int_distribution<int> from(0, static_cast<int>(source.size()) - length);
+            std::uniform_int_distribution<int> to(0, options.tokens - length);
+            int first = from(rng);
+            std::copy(source.begin() + first, source.begin() + first + length,
+                      submission.begin() + to(rng));
+        }
+        words.push_back(submission);
+        trace.push_back({make_submission(directory, options.base + i, submission),
+                         start_time + std::chrono::milliseconds(100) * i});
+    }
+
+    std::printf("%-8s %12s %10s %14s %8s\n", "workers", "submissions", "wall s",
+                "submissions/s", "speedup");
+    std::vector<std::size_t> runs = {0};
+    runs.insert(runs.end(), options.workers.begin(), options.workers.end());
+    std::vector<report_key_t> first_reports;
+    double baseline = 0.0;
+    int status = 0;
+    for (std::size_t workers : runs) {
+        std::vector<report_key_t> reports;
+        double seconds;
+        {
+            plagiarism_checker_t checker(base);
+            if (options.backend) {
+                checker.add_backend(std::make_shared<pairwise_backend_t>(&match_submissions));
+            }
+            if (workers > 0) {
+                checker.set_shards(workers);
+            }
+            auto start = std::chrono::steady_clock::now();
+            checker.replay(trace);
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            for (const trace_event_t& event : trace) {
+                report_key_t key;
+                for (const similarity_report_t& entry : checker.get_report(event.submission)) {
+                    key.push_back({entry.submission->id, entry.score, entry.new_start,
+                                   entry.old_start, entry.length});
+                }
+                reports.push_back(std::move(key));
+            }
+        }
+        if (first_reports.empty()) {
+            first_reports = reports;
+            baseline = seconds;
+        } else if (reports != first_reports) {
+            std::fprintf(stderr, "reports with %zu workers differ from one process\n", workers);
+            status = 1;
+        }
+        std::printf("%-8s %12zu %10.2f %14.1f %8.2f\n",
+                    workers == 0 ? "none" : std::to_string(workers).c_str(), trace.size(),
+                    seconds, trace.size() / seconds, baseline / seconds);
+        std::fflush(stdout);
+    }
+
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        std::remove((directory + "/" + std::to_string(i) + ".cpp").c_str());
+    }
+    ::rmdir(directory.c_str());
+    return status;
+}
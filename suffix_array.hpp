@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+// Suffix array (SA-IS) and LCP array (Kasai) over token sequences, and an
+// index over a pair of submissions built on them. Construction is linear in
+// time and memory.
+namespace suffix_array {
+
+// Suffix array of a sequence whose values lie in [0, upper], by induced
+// sorting (Nong, Zhang and Chan). No sentinel is needed.
+inline std::vector<int> build(std::span<const int> text, int upper) {
+    int n = static_cast<int>(text.size());
+    if (n == 0) {
+        return {};
+    }
+    if (n == 1) {
+        return {0};
+    }
+    if (n == 2) {
+        return text[0] < text[1] ? std::vector<int>{0, 1} : std::vector<int>{1, 0};
+    }
+
+    // is_s[i]: suffix i is smaller than suffix i + 1 (S-type), else L-type.
+    std::vector<char> is_s(n, 0);
+    for (int i = n - 2; i >= 0; --i) {
+        is_s[i] = text[i] == text[i + 1] ? is_s[i + 1] : text[i] < text[i + 1];
+    }
+    // Bucket starts: L-type suffixes of a value come before its S-type ones.
+    std::vector<int> l_start(upper + 2, 0), s_start(upper + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        if (is_s[i]) {
+            ++l_start[text[i] + 1];
+        } else {
+            ++s_start[text[i]];
+        }
+    }
+    for (int c = 0; c <= upper; ++c) {
+        s_start[c] += l_start[c];
+        l_start[c + 1] += s_start[c];
+    }
+
+    std::vector<int> sa(n);
+    std::vector<int> bucket(upper + 2);
+    // Places the given LMS suffixes and induces the order of all others.
+    auto induce = [&](const std::vector<int>& lms) {
+        std::fill(sa.begin(), sa.end(), -1);
+        std::copy(s_start.begin(), s_start.end(), bucket.begin());
+        for (int p : lms) {
+            sa[bucket[text[p]]++] = p;
+        }
+        std::copy(l_start.begin(), l_start.end() - 1, bucket.begin());
+        sa[bucket[text[n - 1]]++] = n - 1;
+        for (int i = 0; i < n; ++i) {
+            int p = sa[i] - 1;
+            if (p >= 0 && !is_s[p]) {
+                sa[bucket[text[p]]++] = p;
+            }
+        }
+        std::copy(l_start.begin(), l_start.end(), bucket.begin());
+        for (int i = n - 1; i >= 0; --i) {
+            int p = sa[i] - 1;
+            if (p >= 0 && is_s[p]) {
+                sa[--bucket[text[p] + 1]] = p;
+            }
+        }
+    };
+
+    // LMS positions: S-type with an L-type predecessor.
+    std::vector<int> lms_index(n, -1);
+    std::vector<int> lms;
+    for (int i = 1; i < n; ++i) {
+        if (!is_s[i - 1] && is_s[i]) {
+            lms_index[i] = static_cast<int>(lms.size());
+            lms.push_back(i);
+        }
+    }
+    induce(lms);
+    if (lms.empty()) {
+        return sa;
+    }
+
+    // Name the LMS substrings in sorted order and sort their sequence recursively.
+    int m = static_cast<int>(lms.size());
+    std::vector<int> sorted_lms;
+    sorted_lms.reserve(m);
+    for (int p : sa) {
+        if (lms_index[p] != -1) {
+            sorted_lms.push_back(p);
+        }
+    }
+    std::vector<int> reduced(m);
+    int name = 0;
+    reduced[lms_index[sorted_lms[0]]] = 0;
+    for (int i = 1; i < m; ++i) {
+        int l = sorted_lms[i - 1], r = sorted_lms[i];
+        int end_l = lms_index[l] + 1 < m ? lms[lms_index[l] + 1] : n;
+        int end_r = lms_index[r] + 1 < m ? lms[lms_index[r] + 1] : n;
+        bool same = end_l - l == end_r - r;
+        if (same) {
+            while (l < end_l && text[l] == text[r]) {
+                ++l;
+                ++r;
+            }
+            same = l < n && text[l] == text[r];
+        }
+        if (!same) {
+            ++name;
+        }
+        reduced[lms_index[sorted_lms[i]]] = name;
+    }
+    std::vector<int> reduced_sa = build(reduced, name);
+    for (int i = 0; i < m; ++i) {
+        sorted_lms[i] = lms[reduced_sa[i]];
+    }
+    induce(sorted_lms);
+    return sa;
+}
+
+// LCP array by Kasai et al.: lcp[i] is the length of the longest common
+// prefix of suffixes sa[i - 1] and sa[i]; lcp[0] is 0.
+inline std::vector<int> lcp(std::span<const int> text, const std::vector<int>& sa) {
+    int n = static_cast<int>(text.size());
+    std::vector<int> rank(n), result(n, 0);
+    for (int i = 0; i < n; ++i) {
+        rank[sa[i]] = i;
+    }
+    int h = 0;
+    for (int p = 0; p < n; ++p) {
+        if (rank[p] == 0) {
+            h = 0;
+            continue;
+        }
+        int q = sa[rank[p] - 1];
+        while (p + h < n && q + h < n && text[p + h] == text[q + h]) {
+            ++h;
+        }
+        result[rank[p]] = h;
+        if (h > 0) {
+            --h;
+        }
+    }
+    return result;
+}
+
+// An exact match between the two submissions of a pair.
+struct exact_match_t {
+    int start1; // Start in the first submission.
+    int start2; // Start in the second submission.
+    int length;
+};
+
+// Suffix and LCP arrays of first + separator + second. Tokens are renumbered
+// from 1 and the separator is 0, so no common prefix runs across it.
+class pair_index_t {
+public:
+    pair_index_t(std::span<const int> first, std::span<const int> second)
+        : first_size_(static_cast<int>(first.size())), first_(first), second_(second) {
+        std::vector<int> tokens(first.begin(), first.end());
+        tokens.insert(tokens.end(), second.begin(), second.end());
+        std::sort(tokens.begin(), tokens.end());
+        tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+        auto renumber = [&](int token) {
+            return static_cast<int>(std::lower_bound(tokens.begin(), tokens.end(), token)
+                                    - tokens.begin()) + 1;
+        };
+        text_.reserve(first.size() + second.size() + 1);
+        for (int token : first) {
+            text_.push_back(renumber(token));
+        }
+        text_.push_back(0);
+        for (int token : second) {
+            text_.push_back(renumber(token));
+        }
+        sa_ = build(text_, static_cast<int>(tokens.size()));
+        lcp_ = lcp(text_, sa_);
+    }
+
+    // Longest common substring of the two submissions; length 0 if none.
+    exact_match_t longest_common_substring(void) const {
+        exact_match_t best = {-1, -1, 0};
+        for (std::size_t i = 1; i < sa_.size(); ++i) {
+            if (lcp_[i] > best.length && in_first(sa_[i - 1]) != in_first(sa_[i])) {
+                best = to_match(sa_[i - 1], sa_[i], lcp_[i]);
+            }
+        }
+        return best;
+    }
+
+    // For each position p of the first submission, the length of the longest
+    // prefix of first[p..] that occurs in the second (matching statistics).
+    std::vector<int> first_in_second(void) const { return matching_statistics(true); }
+
+    // For each position of the second submission, the same against the first.
+    std::vector<int> second_in_first(void) const { return matching_statistics(false); }
+
+    const std::vector<int>& suffixes(void) const { return sa_; }
+    const std::vector<int>& common_prefixes(void) const { return lcp_; }
+
+private:
+    bool in_first(int position) const { return position < first_size_; }
+
+    // The longest prefix of a suffix found in the other side is its LCP with
+    // the nearest suffix of the other side above or below it in the array.
+    std::vector<int> matching_statistics(bool of_first) const {
+        int n = static_cast<int>(sa_.size());
+        int offset = of_first ? 0 : first_size_ + 1;
+        std::vector<int> result(of_first ? first_.size() : second_.size(), 0);
+        auto is_query = [&](int position) {
+            return position != first_size_ && in_first(position) == of_first;
+        };
+        auto is_other = [&](int position) {
+            return position != first_size_ && in_first(position) != of_first;
+        };
+        int common = 0; // LCP with the nearest other-side suffix seen so far.
+        for (int k = 0; k < n; ++k) {
+            common = k > 0 ? std::min(common, lcp_[k]) : 0;
+            if (is_other(sa_[k])) {
+                common = n;
+            } else if (is_query(sa_[k])) {
+                result[sa_[k] - offset] = common;
+            }
+        }
+        common = 0;
+        for (int k = n - 1; k >= 0; --k) {
+            common = k + 1 < n ? std::min(common, lcp_[k + 1]) : 0;
+            if (is_other(sa_[k])) {
+                common = n;
+            } else if (is_query(sa_[k])) {
+                result[sa_[k] - offset] = std::max(result[sa_[k] - offset], common);
+            }
+        }
+        return result;
+    }
+
+    exact_match_t to_match(int a, int b, int length) const {
+        if (!in_first(a)) {
+            std::swap(a, b);
+        }
+        return {a, b - first_size_ - 1, length};
+    }
+
+    int first_size_;
+    std::span<const int> first_;
+    std::span<const int> second_;
+    std::vector<int> text_; // Renumbered first, 0, renumbered second.
+    std::vector<int> sa_;
+    std::vector<int> lcp_;
+};
+
+} // namespace suffix_array
@@ -0,0 +1,103 @@
+// Checks bit_parallel_lcs against the full LCS table it replaced in
+// checker_three and checker_four, on random pairs of every shape around the
+// 64-column word boundaries, and the checkpointed traceback on row counts
+// around the checkpoint stride.
+#include "bit_parallel_lcs.hpp"
+// -----------------------------------------------------------------------------
+#include "test_util.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using test_util::check;
+using test_util::random_tokens;
+
+namespace {
+
+// The (m + 1) x (n + 1) table of SequenceMatcher::getLCS.
+std::vector<std::vector<int>> lcs_table(const std::vector<int>& a, const std::vector<int>& b) {
+    std::vector<std::vector<int>> dp(a.size() + 1, std::vector<int>(b.size() + 1, 0));
+    for (std::size_t i = 1; i <= a.size(); ++i) {
+        for (std::size_t j = 1; j <= b.size(); ++j) {
+            dp[i][j] = a[i - 1] == b[j - 1] ? dp[i - 1][j - 1] + 1
+                                             : std::max(dp[i - 1][j], dp[i][j - 1]);
+        }
+    }
+    return dp;
+}
+
+// The traceback of SequenceMatcher::getLCS.
+std::vector<std::pair<int, int>> naive_alignment(const std::vector<int>& a, const std::vector<int>& b) {
+    std::vector<std::vector<int>> dp = lcs_table(a, b);
+    std::vector<std::pair<int, int>> pairs;
+    std::size_t i = a.size(), j = b.size();
+    while (i > 0 && j > 0) {
+        if (a[i - 1] == b[j - 1]) {
+            pairs.push_back({static_cast<int>(i - 1), static_cast<int>(j - 1)});
+            --i;
+            --j;
+        } else if (dp[i - 1][j] > dp[i][j - 1]) {
+            --i;
+        } else {
+            --j;
+        }
+    }
+    std::reverse(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+} // namespace
+
+int main(void) {
+    const int sizes[] = {0, 1, 2, 17, 63, 64, 65, 127, 128, 129, 200, 300};
+    int cases = 0;
+    for (unsigned seed = 0; seed < 400; ++seed) {
+        std::mt19937 rng(seed);
+        int m = sizes[rng() % std::size(sizes)];
+        int n = sizes[rng() % std::size(sizes)];
+        int alphabet = 2 + static_cast<int>(rng() % 40);
+        std::vector<int> a = random_tokens(rng, m, alphabet);
+        std::vector<int> b = random_tokens(rng, n, alphabet);
+        if (seed % 4 == 0 && m > 0) {
+            // A lightly edited copy, for long alignments.
+            b = a;
+            for (int& t : b) {
+                if (rng() % 10 == 0) {
+                    t = static_cast<int>(rng() % alphabet);
+                }
+            }
+        }
+        check(bit_parallel_lcs::length(a, b) == lcs_table(a, b)[m][b.size()], "length", seed);
+        check(bit_parallel_lcs::alignment(a, b) == naive_alignment(a, b), "alignment", seed);
+        ++cases;
+    }
+    // alignment() keeps every stride-th row, stride = floor(sqrt(m)), and
+    // rebuilds the rows between them: row counts at and next to perfect
+    // squares put the walk on, just after and just before a checkpoint, and
+    // tall or wide pairs give one-word rows or blocks of a single row.
+    const int rows[] = {3, 4, 5, 15, 16, 17, 99, 100, 101, 143, 144, 145, 1023, 1024, 1025};
+    const int columns[] = {1, 5, 64, 150, 700};
+    for (unsigned seed = 1000; seed < 1200; ++seed) {
+        std::mt19937 rng(seed);
+        int m = rows[rng() % std::size(rows)];
+        int n = columns[rng() % std::size(columns)];
+        if (seed % 2 == 0) {
+            std::swap(m, n);
+        }
+        int alphabet = 2 + static_cast<int>(rng() % 20);
+        std::vector<int> a = random_tokens(rng, m, alphabet);
+        std::vector<int> b = random_tokens(rng, n, alphabet);
+        if (seed % 3 == 0) {
+            // b edited from a prefix of a, so the walk runs the full height.
+            b.assign(a.begin(), a.begin() + std::min(m, n));
+            for (int& t : b) {
+                if (rng() % 8 == 0) {
+                    t = static_cast<int>(rng() % alphabet);
+                }
+            }
+        }
+        check(bit_parallel_lcs::alignment(a, b) == naive_alignment(a, b), "checkpointed alignment", seed);
+        ++cases;
+    }
+    return test_util::summary("bit_parallel_lcs", cases);
+}
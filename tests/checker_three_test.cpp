@@ -0,0 +1,149 @@
+// Checks checker_three's find_total_match_length (result[1]) against the
+// std::string-keyed version it replaced, which is kept here as the
+// reference.
+#define CHECKER_REGISTRY
+#include "checker_three.hpp"
+// -----------------------------------------------------------------------------
+#include "test_util.hpp"
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reference {
+
+std::unordered_map<std::string, std::vector<int>> get_n_length_substrings(const std::vector<int>& tokens, int n, std::set<int>& used_indices) {
+    std::unordered_map<std::string, std::vector<int>> substrings;
+    for (size_t i = 0; i + n <= tokens.size(); ++i) {
+        bool overlap = false;
+        for (int j = 0; j < n; ++j) {
+            if (used_indices.count(i + j)) {
+                overlap = true;
+                break;
+            }
+        }
+        if (overlap) continue;
+        std::string pattern;
+        for (int j = 0; j < n; ++j) {
+            pattern += std::to_string(tokens[i + j]) + ",";
+        }
+        substrings[pattern].push_back(i);
+    }
+    return substrings;
+}
+
+int find_total_match_length(const std::vector<int>& submission1, const std::vector<int>& submission2, int min_match_len = 10, int max_match_len = 29) {
+    int total_length = 0;
+    std::set<int> used_indices1, used_indices2;
+    for (int n = max_match_len; n >= min_match_len; --n) {
+        std::unordered_map<std::string, std::vector<int>> patterns1 = get_n_length_substrings(submission1, n, used_indices1);
+        std::unordered_map<std::string, std::vector<int>> patterns2 = get_n_length_substrings(submission2, n, used_indices2);
+        for (const auto& entry : patterns1) {
+            const std::string& pattern = entry.first;
+            if (patterns2.find(pattern) != patterns2.end()) {
+                for (int idx1 : patterns1[pattern]) {
+                    bool overlap1 = false;
+                    for (int j = 0; j < n; ++j) {
+                        if (used_indices1.count(idx1 + j)) {
+                            overlap1 = true;
+                            break;
+                        }
+                    }
+                    if (overlap1) continue;
+                    for (int idx2 : patterns2[pattern]) {
+                        bool overlap2 = false;
+                        for (int j = 0; j < n; ++j) {
+                            if (used_indices2.count(idx2 + j)) {
+                                overlap2 = true;
+                                break;
+                            }
+                        }
+                        if (overlap2) continue;
+                        total_length += n;
+                        for (int j = 0; j < n; ++j) {
+                            used_indices1.insert(idx1 + j);
+                            used_indices2.insert(idx2 + j);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return total_length;
+}
+
+} // namespace reference
+
+using test_util::check;
+
+namespace {
+
+// Tokens skewed towards the small ones, so common windows repeat.
+std::vector<int> skewed_tokens(std::mt19937& rng, int size, int alphabet) {
+    std::geometric_distribution<int> token(4.0 / alphabet);
+    std::vector<int> tokens(size);
+    for (int& t : tokens) {
+        t = std::min(token(rng), alphabet - 1);
+    }
+    return tokens;
+}
+
+// Pairs with many overlapping candidate matches, where the order in which
+// they are taken decides the total: unrelated code, an edited copy, a copy
+// with shuffled blocks, and code borrowing repeated blocks.
+std::pair<std::vector<int>, std::vector<int>> make_pair(std::mt19937& rng, int size, int kind) {
+    int alphabet = 4 + static_cast<int>(rng() % 60);
+    std::vector<int> first = skewed_tokens(rng, size, alphabet);
+    std::vector<int> second;
+    if (kind == 0) {
+        second = skewed_tokens(rng, size, alphabet);
+    } else if (kind == 1) {
+        for (int t : first) {
+            int roll = static_cast<int>(rng() % 100);
+            if (roll < 4) {
+                second.push_back(static_cast<int>(rng() % alphabet));
+            } else if (roll < 8) {
+                second.push_back(t);
+                second.push_back(static_cast<int>(rng() % alphabet));
+            } else if (roll >= 12) {
+                second.push_back(t);
+            }
+        }
+    } else if (kind == 2) {
+        std::vector<std::vector<int>> blocks;
+        for (std::size_t i = 0; i < first.size();) {
+            std::size_t end = std::min(first.size(), i + 15 + rng() % 40);
+            blocks.emplace_back(first.begin() + i, first.begin() + end);
+            i = end;
+        }
+        std::shuffle(blocks.begin(), blocks.end(), rng);
+        for (const std::vector<int>& block : blocks) {
+            second.insert(second.end(), block.begin(), block.end());
+        }
+    } else {
+        second = skewed_tokens(rng, size, alphabet);
+        std::vector<int> block(first.begin(), first.begin() + std::min(size, 40));
+        for (int copies = 0; copies < 6; ++copies) {
+            std::size_t at = rng() % (second.size() + 1);
+            second.insert(second.begin() + at, block.begin(), block.end());
+        }
+    }
+    return {first, second};
+}
+
+} // namespace
+
+int main(void) {
+    int cases = 0;
+    for (unsigned seed = 0; seed < 400; ++seed) {
+        std::mt19937 rng(seed);
+        auto [first, second] = make_pair(rng, 20 + static_cast<int>(rng() % 1200), seed % 4);
+        check(checker_three::find_total_match_length(first, second)
+                  == reference::find_total_match_length(first, second), "total match length", seed);
+        ++cases;
+    }
+    return test_util::summary("checker_three", cases);
+}
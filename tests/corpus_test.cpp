@@ -0,0 +1,180 @@
+// Checks corpus files against the vectors they were written from: both token
+// widths, views and copies, corpus::match against calling the checker
+// directly, and damaged files against the errors they must raise.
+#include "corpus.hpp"
+// -----------------------------------------------------------------------------
+#include "test_util.hpp"
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+using test_util::check;
+
+namespace {
+
+std::string temporary_path(void) {
+    char path[] = "/tmp/corpus_test.XXXXXX";
+    int fd = ::mkstemp(path);
+    ::close(fd);
+    return path;
+}
+
+std::vector<std::vector<int>> random_submissions(std::mt19937& rng, int max_token) {
+    std::vector<std::vector<int>> submissions(rng() % 12);
+    std::uniform_int_distribution<int> token(0, max_token);
+    for (std::vector<int>& tokens : submissions) {
+        tokens.resize(rng() % 4 == 0 ? 0 : rng() % 300);
+        for (int& t : tokens) {
+            t = token(rng);
+        }
+    }
+    return submissions;
+}
+
+// A stand-in checker: sums of both submissions, and it clobbers its
+// arguments as the real ones may.
+std::array<int, 5> sums(std::vector<int>& a, std::vector<int>& b) {
+    std::array<int, 5> result{};
+    for (int t : a) result[1] += t;
+    for (int t : b) result[2] += t;
+    result[3] = static_cast<int>(a.size());
+    result[4] = static_cast<int>(b.size());
+    a.clear();
+    b.push_back(1);
+    return result;
+}
+
+// Returns what opening path throws: "none", "system", "runtime" or "other".
+template <typename Damage>
+std::string open_damaged(const std::string& path, Damage damage) {
+    std::vector<std::vector<int>> submissions = {{1, 2, 3}, {}, {4, 5}};
+    corpus::write(path, submissions);
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    damage(bytes);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    try {
+        corpus::corpus_t corpus(path);
+    } catch (const std::system_error&) {
+        return "system";
+    } catch (const std::runtime_error&) {
+        return "runtime";
+    } catch (...) {
+        return "other";
+    }
+    return "none";
+}
+
+} // namespace
+
+int main(void) {
+    int cases = 0;
+    std::string path = temporary_path();
+
+    for (unsigned seed = 0; seed < 200; ++seed) {
+        std::mt19937 rng(seed);
+        corpus::width_t width = seed % 2 == 0 ? corpus::width_t::int32 : corpus::width_t::uint16;
+        std::vector<std::vector<int>> submissions =
+            random_submissions(rng, width == corpus::width_t::int32 ? 1 << 30 : 0xffff);
+        if (width == corpus::width_t::int32 && !submissions.empty() && !submissions[0].empty()) {
+            submissions[0][0] = -7;
+        }
+        corpus::write(path, submissions, width);
+        corpus::corpus_t corpus(path);
+        check(corpus.size() == submissions.size(), "size", seed);
+        check(corpus.width() == width, "width", seed);
+
+        std::vector<int> copied = {9, 9, 9};
+        for (std::size_t i = 0; i < submissions.size(); ++i) {
+            check(corpus.length(i) == submissions[i].size(), "length", seed);
+            corpus.copy(i, copied);
+            check(copied == submissions[i], "copy", seed);
+            if (width == corpus::width_t::int32) {
+                std::span<const int> view = corpus.tokens(i);
+                check(std::vector<int>(view.begin(), view.end()) == submissions[i], "tokens", seed);
+            }
+        }
+        if (width == corpus::width_t::int32) {
+            std::vector<std::span<const int>> views = corpus.views();
+            check(views.size() == submissions.size(), "views", seed);
+            for (std::size_t i = 0; i + 1 < views.size(); ++i) {
+                std::vector<int> a = submissions[i], b = submissions[i + 1];
+                check(corpus::match(&sums, views[i], views[i + 1]) == sums(a, b), "match", seed);
+                // The buffers the checker clobbered are refilled on the next call.
+                a = submissions[i];
+                b = submissions[i + 1];
+                check(corpus::match(&sums, views[i], views[i + 1]) == sums(a, b), "match again", seed);
+            }
+        } else {
+            bool thrown = false;
+            try {
+                corpus.tokens(0);
+            } catch (const std::logic_error&) {
+                thrown = true;
+            }
+            check(thrown, "tokens of a 16-bit corpus", seed);
+        }
+
+        // A moved corpus keeps its mapping; the moved-from one is empty.
+        corpus::corpus_t moved = std::move(corpus);
+        check(moved.size() == submissions.size(), "moved size", seed);
+        for (std::size_t i = 0; i < submissions.size(); ++i) {
+            moved.copy(i, copied);
+            check(copied == submissions[i], "moved copy", seed);
+        }
+        ++cases;
+    }
+
+    // Tokens outside 16 bits are refused, and the old file is left alone.
+    for (int token : {-1, 0x10000}) {
+        corpus::write(path, {{1, 2}});
+        bool thrown = false;
+        try {
+            corpus::write(path, {{1, token}}, corpus::width_t::uint16);
+        } catch (const std::out_of_range&) {
+            thrown = true;
+        }
+        check(thrown, "16-bit token out of range", token);
+        corpus::corpus_t corpus(path);
+        check(corpus.size() == 1 && corpus.width() == corpus::width_t::int32, "file kept after a refused write", token);
+        ++cases;
+    }
+
+    // Damaged files.
+    auto truncate_to = [](std::size_t size) { return [size](std::string& bytes) { bytes.resize(size); }; };
+    check(open_damaged(path, [](std::string&) {}) == "none", "undamaged file", 0);
+    check(open_damaged(path, truncate_to(0)) == "runtime", "empty file", 0);
+    check(open_damaged(path, truncate_to(sizeof(corpus::header_t) - 1)) == "runtime", "truncated header", 0);
+    check(open_damaged(path, truncate_to(sizeof(corpus::header_t) + 8)) == "runtime", "truncated offsets", 0);
+    check(open_damaged(path, [](std::string& bytes) { bytes.pop_back(); }) == "runtime", "truncated tokens", 0);
+    check(open_damaged(path, [](std::string& bytes) { bytes[0] = 'X'; }) == "runtime", "bad magic", 0);
+    check(open_damaged(path, [](std::string& bytes) { bytes[8] ^= 1; }) == "runtime", "bad version", 0);
+    check(open_damaged(path, [](std::string& bytes) { bytes[12] = 3; }) == "runtime", "bad width", 0);
+    check(open_damaged(path, [](std::string& bytes) { bytes[sizeof(corpus::header_t)] = 1; }) == "runtime",
+          "first offset not zero", 0);
+    // Offsets 0, 3, 3, 5: raising the third to 6 puts it above the fourth.
+    check(open_damaged(path, [](std::string& bytes) { bytes[sizeof(corpus::header_t) + 16] = 6; }) == "runtime",
+          "decreasing offsets", 0);
+    std::remove(path.c_str());
+    bool thrown = false;
+    try {
+        corpus::corpus_t corpus("/nonexistent/corpus");
+    } catch (const std::system_error&) {
+        thrown = true;
+    }
+    check(thrown, "missing file", 0);
+    cases += 12;
+
+    return test_util::summary("corpus", cases);
+}
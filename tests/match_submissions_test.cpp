@@ -0,0 +1,112 @@
+// Checks checker_sample's greedy string tiling (result[1]) against the
+// textbook greedy: repeatedly take every longest common run of untiled
+// tokens, at least Policy::minimumMatchLength long, that no tile of the same
+// round has covered, found by comparing every pair of starts.
+#define CHECKER_REGISTRY
+#include "match_submissions.hpp"
+// -----------------------------------------------------------------------------
+#include "test_util.hpp"
+#include <random>
+#include <vector>
+
+using test_util::check;
+using test_util::random_tokens;
+
+namespace {
+
+int naive_tiling(const std::vector<int>& a, const std::vector<int>& b) {
+    std::vector<bool> used_a(a.size(), false), used_b(b.size(), false);
+    int total = 0;
+    while (true) {
+        struct run_t {
+            std::size_t length, start_a, start_b;
+        };
+        std::vector<run_t> longest;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            for (std::size_t j = 0; j < b.size(); ++j) {
+                std::size_t k = 0;
+                while (i + k < a.size() && j + k < b.size() && a[i + k] == b[j + k]
+                        && !used_a[i + k] && !used_b[j + k]) {
+                    ++k;
+                }
+                if (k > 0 && (longest.empty() || k > longest[0].length)) {
+                    longest.clear();
+                }
+                if (k > 0 && (longest.empty() || k == longest[0].length)) {
+                    longest.push_back({k, i, j});
+                }
+            }
+        }
+        if (longest.empty() || longest[0].length < checker_sample::Policy::minimumMatchLength) {
+            return total;
+        }
+        for (const run_t& run : longest) {
+            bool occluded = false;
+            for (std::size_t k = 0; k < run.length; ++k) {
+                occluded = occluded || used_a[run.start_a + k] || used_b[run.start_b + k];
+            }
+            if (occluded) {
+                continue;
+            }
+            for (std::size_t k = 0; k < run.length; ++k) {
+                used_a[run.start_a + k] = used_b[run.start_b + k] = true;
+            }
+            total += static_cast<int>(run.length);
+        }
+    }
+}
+
+// b with blocks of a copied over it, some with a token in ten changed, so
+// runs of every length compete for the same tokens.
+std::pair<std::vector<int>, std::vector<int>> make_pair(std::mt19937& rng, unsigned seed) {
+    int alphabet = seed % 3 == 0 ? 4 : seed % 3 == 1 ? 20 : 100;
+    std::vector<int> a = random_tokens(rng, 20 + static_cast<int>(rng() % 400), alphabet);
+    std::vector<int> b = random_tokens(rng, 20 + static_cast<int>(rng() % 400), alphabet);
+    int copies = 1 + static_cast<int>(rng() % 4);
+    for (int c = 0; c < copies; ++c) {
+        std::size_t length = 5 + rng() % (std::min(a.size(), b.size()) / 2);
+        std::size_t from = rng() % (a.size() - length + 1), to = rng() % (b.size() - length + 1);
+        for (std::size_t k = 0; k < length; ++k) {
+            b[to + k] = seed % 2 == 0 && rng() % 10 == 0 ? static_cast<int>(rng() % alphabet) : a[from + k];
+        }
+    }
+    return {a, b};
+}
+
+} // namespace
+
+int main(void) {
+    const std::size_t window = checker_sample::Policy::minimumMatchLength;
+    int cases = 0;
+    for (unsigned seed = 0; seed < 300; ++seed) {
+        std::mt19937 rng(seed);
+        auto [a, b] = make_pair(rng, seed);
+        std::vector<bool> used_a(a.size(), false), used_b(b.size(), false);
+        int total = checker_sample::greedyStringTiling(a, b, checker_sample::WindowHashes(a),
+                                                       checker_sample::WindowHashes(b), used_a, used_b);
+        check(total == naive_tiling(a, b), "total against the naive tiling", seed);
+
+        // The tiles never overlap, so each side has total tokens tiled.
+        int tiled_a = 0, tiled_b = 0;
+        for (bool used : used_a) tiled_a += used;
+        for (bool used : used_b) tiled_b += used;
+        check(tiled_a == total && tiled_b == total, "tiles are disjoint", seed);
+
+        // No common window of untiled tokens is left.
+        bool maximal = true;
+        for (std::size_t i = 0; i + window <= a.size() && maximal; ++i) {
+            for (std::size_t j = 0; j + window <= b.size() && maximal; ++j) {
+                bool free_match = true;
+                for (std::size_t k = 0; k < window && free_match; ++k) {
+                    free_match = !used_a[i + k] && !used_b[j + k] && a[i + k] == b[j + k];
+                }
+                maximal = !free_match;
+            }
+        }
+        check(maximal, "tiling is maximal", seed);
+
+        check(checker_sample::match_submissions(a, b)[1] == total, "result[1] is the tiling", seed);
+        ++cases;
+    }
+    return test_util::summary("match_submissions", cases);
+}
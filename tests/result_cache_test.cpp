@@ -0,0 +1,134 @@
+// Checks result_cache against computing every result: lookups against a
+// plain map of what was inserted, fingerprints against comparing the token
+// sequences, and a saved and reloaded cache against the one saved.
+#include "result_cache.hpp"
+// -----------------------------------------------------------------------------
+#include "test_util.hpp"
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+using test_util::check;
+using test_util::random_tokens;
+
+namespace {
+
+using result_t = result_cache::cache_t::result_t;
+
+result_t random_result(std::mt19937& rng) {
+    std::uniform_int_distribution<int> value(-1, 5000);
+    return {static_cast<int>(rng() % 2), value(rng), value(rng), value(rng), value(rng)};
+}
+
+} // namespace
+
+int main(void) {
+    int cases = 0;
+
+    // Sequences that differ in one token, in length only, or by a negative
+    // token must not share a fingerprint; equal ones must.
+    std::mt19937 rng(0);
+    std::vector<std::vector<int>> sequences = {{}, {0}, {0, 0}, {-1}, {1, 2, 3}, {3, 2, 1}};
+    for (int i = 0; i < 300; ++i) {
+        std::vector<int> tokens = random_tokens(rng, static_cast<int>(rng() % 40), 1 + static_cast<int>(rng() % 4));
+        sequences.push_back(tokens);
+        if (!tokens.empty()) {
+            tokens[rng() % tokens.size()] ^= 1;
+            sequences.push_back(tokens);
+            tokens.pop_back();
+            sequences.push_back(tokens);
+        }
+    }
+    for (std::size_t i = 0; i < sequences.size(); ++i) {
+        for (std::size_t j = 0; j < sequences.size(); ++j) {
+            bool same = result_cache::fingerprint(sequences[i]) == result_cache::fingerprint(sequences[j]);
+            check(same == (sequences[i] == sequences[j]), "fingerprint", static_cast<unsigned>(i));
+        }
+        ++cases;
+    }
+
+    // Random inserts, overwrites and lookups under several checker ids.
+    const std::string checkers[] = {"three@1", "three@2", "sample@1"};
+    for (unsigned seed = 0; seed < 100; ++seed) {
+        std::mt19937 rng(seed);
+        std::vector<result_cache::fingerprint_t> fingerprints;
+        for (int i = 0; i < 8; ++i) {
+            fingerprints.push_back(result_cache::fingerprint(random_tokens(rng, 5 + i, 50)));
+        }
+        result_cache::cache_t cache;
+        std::map<std::tuple<std::string, int, int>, result_t> expected;
+        for (int step = 0; step < 200; ++step) {
+            const std::string& checker = checkers[rng() % std::size(checkers)];
+            int first = static_cast<int>(rng() % fingerprints.size());
+            int second = static_cast<int>(rng() % fingerprints.size());
+            if (rng() % 2 == 0) {
+                result_t result = random_result(rng);
+                cache.insert(checker, fingerprints[first], fingerprints[second], result);
+                expected[{checker, first, second}] = result;
+                continue;
+            }
+            auto found = expected.find({checker, first, second});
+            std::optional<result_t> result = cache.find(checker, fingerprints[first], fingerprints[second]);
+            check(found == expected.end() ? !result : result == found->second, "find", seed);
+
+            // Symmetric lookups fall back to the reverse pair with the starts swapped.
+            auto reverse = expected.find({checker, second, first});
+            std::optional<result_t> symmetric =
+                cache.find(checker, fingerprints[first], fingerprints[second], true);
+            if (found != expected.end()) {
+                check(symmetric == found->second, "symmetric find", seed);
+            } else if (reverse != expected.end()) {
+                result_t swapped = reverse->second;
+                std::swap(swapped[3], swapped[4]);
+                check(symmetric == swapped, "symmetric find of the reverse pair", seed);
+            } else {
+                check(!symmetric, "symmetric miss", seed);
+            }
+        }
+        check(cache.size() == expected.size(), "size", seed);
+
+        // find_or_compute computes misses only, and keeps what it computed.
+        int computed = 0, misses = 0;
+        for (int first = 0; first < 8; ++first) {
+            misses += expected.count({"sample@1", first, 0}) == 0;
+            result_t result = cache.find_or_compute("sample@1", fingerprints[first], fingerprints[0], false,
+                                                    [&] { ++computed; return result_t{0, first, 0, 0, 0}; });
+            auto found = expected.find({"sample@1", first, 0});
+            check(result == (found == expected.end() ? result_t{0, first, 0, 0, 0} : found->second),
+                  "find_or_compute", seed);
+            expected.insert({{"sample@1", first, 0}, result});
+        }
+        check(computed == misses && cache.size() == expected.size(), "find_or_compute misses", seed);
+
+        // A saved cache loads back with the same entries; lines that do not
+        // parse are skipped.
+        char path[] = "/tmp/result_cache_test.XXXXXX";
+        int fd = ::mkstemp(path);
+        ::close(fd);
+        check(cache.save(path), "save", seed);
+        {
+            std::ofstream out(path, std::ios::app);
+            out << "three@1 0123 4567 1 2 3 4 5\n"
+                << "three@1 00000000000000000000000000000000 00000000000000000000000000000000 1 2 3\n"
+                << "garbage\n";
+        }
+        result_cache::cache_t loaded;
+        check(loaded.load(path), "load", seed);
+        check(loaded.size() == expected.size(), "loaded size", seed);
+        for (const auto& [key, result] : expected) {
+            const auto& [checker, first, second] = key;
+            check(loaded.find(checker, fingerprints[first], fingerprints[second]) == result, "loaded entry", seed);
+        }
+        std::remove(path);
+        ++cases;
+    }
+    result_cache::cache_t missing;
+    check(!missing.load("/nonexistent/result_cache"), "load of a missing file", 0);
+
+    return test_util::summary("result_cache", cases);
+}
@@ -0,0 +1,90 @@
+// Checks suffix_array against brute force: suffix arrays against sorting the
+// suffixes, LCP arrays against comparing neighbours, and the pair index
+// against enumerating every pair of start positions.
+#include "suffix_array.hpp"
+// -----------------------------------------------------------------------------
+#include "test_util.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using test_util::check;
+using test_util::random_tokens;
+
+namespace {
+
+// Length of the common prefix of a[p..] and b[q..].
+int common_prefix(const std::vector<int>& a, int p, const std::vector<int>& b, int q) {
+    int length = 0;
+    while (p + length < static_cast<int>(a.size()) && q + length < static_cast<int>(b.size())
+            && a[p + length] == b[q + length]) {
+        ++length;
+    }
+    return length;
+}
+
+std::vector<int> naive_suffix_array(const std::vector<int>& text) {
+    std::vector<int> sa(text.size());
+    for (std::size_t i = 0; i < sa.size(); ++i) {
+        sa[i] = static_cast<int>(i);
+    }
+    std::sort(sa.begin(), sa.end(), [&](int a, int b) {
+        return std::lexicographical_compare(text.begin() + a, text.end(), text.begin() + b, text.end());
+    });
+    return sa;
+}
+
+// For each start of a, the longest prefix of a[p..] found anywhere in b.
+std::vector<int> naive_matching_statistics(const std::vector<int>& a, const std::vector<int>& b) {
+    std::vector<int> result(a.size(), 0);
+    for (std::size_t p = 0; p < a.size(); ++p) {
+        for (std::size_t q = 0; q < b.size(); ++q) {
+            result[p] = std::max(result[p], common_prefix(a, static_cast<int>(p), b, static_cast<int>(q)));
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+int main(void) {
+    int cases = 0;
+    for (unsigned seed = 0; seed < 3000; ++seed) {
+        std::mt19937 rng(seed);
+        // Small alphabets give long repeats, which exercise the recursion of SA-IS.
+        int alphabet = 1 + static_cast<int>(rng() % (seed % 3 == 0 ? 3 : 30));
+        std::vector<int> text = random_tokens(rng, static_cast<int>(rng() % 80), alphabet);
+
+        std::vector<int> sa = suffix_array::build(text, alphabet - 1);
+        check(sa == naive_suffix_array(text), "suffix array", seed);
+        std::vector<int> lcp = suffix_array::lcp(text, sa);
+        bool lcp_ok = lcp.size() == text.size();
+        for (std::size_t i = 1; lcp_ok && i < sa.size(); ++i) {
+            lcp_ok = lcp[i] == common_prefix(text, sa[i - 1], text, sa[i]);
+        }
+        check(lcp_ok, "lcp", seed);
+
+        // Pairs share blocks of the text, so common substrings are long.
+        std::vector<int> other = random_tokens(rng, static_cast<int>(rng() % 60), alphabet);
+        if (!text.empty() && rng() % 2 == 0) {
+            std::size_t from = rng() % text.size();
+            std::size_t to = other.empty() ? 0 : rng() % other.size();
+            other.insert(other.begin() + to, text.begin() + from, text.end());
+        }
+        suffix_array::pair_index_t index(text, other);
+        std::vector<int> first = naive_matching_statistics(text, other);
+        std::vector<int> second = naive_matching_statistics(other, text);
+        check(index.first_in_second() == first, "first_in_second", seed);
+        check(index.second_in_first() == second, "second_in_first", seed);
+
+        suffix_array::exact_match_t longest = index.longest_common_substring();
+        int expected = first.empty() ? 0 : *std::max_element(first.begin(), first.end());
+        check(longest.length == expected, "longest common substring length", seed);
+        if (longest.length > 0) {
+            check(common_prefix(text, longest.start1, other, longest.start2) >= longest.length,
+                  "longest common substring position", seed);
+        }
+        ++cases;
+    }
+    return test_util::summary("suffix_array", cases);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Helpers shared by the kernel tests: failure counting, random token
+// sequences and the summary line every test ends with.
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace test_util {
+
+inline int failures = 0;
+
+// Counts and reports a failed check; seed identifies the case.
+inline void check(bool condition, const char* what, unsigned seed) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL %s (seed %u)\n", what, seed);
+        ++failures;
+    }
+}
+
+// size tokens drawn uniformly from 0 .. alphabet - 1.
+inline std::vector<int> random_tokens(std::mt19937& rng, int size, int alphabet) {
+    std::uniform_int_distribution<int> token(0, alphabet - 1);
+    std::vector<int> tokens(size);
+    for (int& t : tokens) {
+        t = token(rng);
+    }
+    return tokens;
+}
+
+// Prints "name: N cases, F failures" and returns the exit status of the test.
+inline int summary(const char* name, int cases) {
+    std::printf("%s: %d cases, %d failures\n", name, cases, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace test_util